@@ -0,0 +1,255 @@
+/*
+   Copyright 2023 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "../Internal.h"
+
+#include <stdlib.h>
+
+static uint64_t _trmGlobalEpoch = 0;
+
+static TrmMutex                  _trmEpochLock = TRM_MUTEX_INITIALIZER; // guards the list of records and the orphans
+static struct TrmEpochRecord_T*  _trmEpochRecords = NULL;
+static struct TrmEpochRetired_T* _trmEpochOrphanHead = NULL; // what unregistered threads retired but couldn't free. Freed by the threads that are still running
+static struct TrmEpochRetired_T* _trmEpochOrphanTail = NULL;
+static uint64_t                  _trmEpochOrphanCount = 0;
+
+/* -------------------- *
+ *       INTERNAL       *
+ * -------------------- */
+
+void _trmEpochThreadRegister(void)
+{
+    struct TrmEpochRecord_T* record = &TRM_THREAD_CONTEXT->epochRecord;
+
+    if (record->isRegistered == true)
+        return;
+
+    TRM_MUTEX_LOCK(&_trmEpochLock);
+    record->previous = NULL;
+    record->next = _trmEpochRecords;
+    if (_trmEpochRecords != NULL)
+        _trmEpochRecords->previous = record;
+    _trmEpochRecords = record;
+    TRM_MUTEX_UNLOCK(&_trmEpochLock);
+
+    record->isRegistered = true;
+}
+
+static struct TrmEpochRecord_T* _trmEpochRecordGet(void);
+static struct TrmEpochRecord_T* _trmEpochRecordGet(void)
+{
+    struct TrmEpochRecord_T* record = &TRM_THREAD_CONTEXT->epochRecord;
+
+    if (record->isRegistered == false) // a thread Termite didn't create, or one that unregistered early
+        _trmEpochThreadRegister();
+
+    return record;
+}
+
+// moves the global epoch forward if every thread in a critical section has seen the current one. Returns the global epoch
+static uint64_t _trmEpochAdvance(void);
+static uint64_t _trmEpochAdvance(void)
+{
+    uint64_t epoch = TRM_ATOMIC_LOAD64(&_trmGlobalEpoch);
+    bool canAdvance = true;
+
+    TRM_ATOMIC_FENCE(); // pairs with the fence in trmEpochEnter, so what was unlinked before this is never missed by a reader that isn't seen below
+
+    TRM_MUTEX_LOCK(&_trmEpochLock);
+    for (struct TrmEpochRecord_T* record = _trmEpochRecords; record != NULL; record = record->next)
+    {
+        uint64_t announced = TRM_ATOMIC_LOAD64(&record->announced);
+
+        if ((announced & 1) == 1 && (announced >> 1) != epoch)
+        {
+            canAdvance = false;
+            break;
+        }
+    }
+    TRM_MUTEX_UNLOCK(&_trmEpochLock);
+
+    if (canAdvance == true)
+        TRM_ATOMIC_CAS64(&_trmGlobalEpoch, epoch, epoch + 1); // if it fails, another thread has moved it already
+
+    return TRM_ATOMIC_LOAD64(&_trmGlobalEpoch);
+}
+
+// detaches the part of a limbo list that can be freed at `epoch`. As objects are retired in order, that's always a part at the start of the list
+static struct TrmEpochRetired_T* _trmEpochExpiredCut(struct TrmEpochRetired_T** pHead, struct TrmEpochRetired_T** pTail, uint64_t* pCount, uint64_t epoch);
+static struct TrmEpochRetired_T* _trmEpochExpiredCut(struct TrmEpochRetired_T** pHead, struct TrmEpochRetired_T** pTail, uint64_t* pCount, uint64_t epoch)
+{
+    struct TrmEpochRetired_T* expired = *pHead;
+    struct TrmEpochRetired_T* last = NULL;
+
+    for (struct TrmEpochRetired_T* retired = *pHead; retired != NULL && retired->epoch + 2 <= epoch; retired = retired->next)
+    {
+        last = retired;
+        (*pCount)--;
+    }
+
+    if (last == NULL)
+        return NULL;
+
+    *pHead = last->next;
+    if (*pHead == NULL)
+        *pTail = NULL;
+    last->next = NULL;
+
+    return expired;
+}
+
+static void _trmEpochRetiredFree(struct TrmEpochRetired_T* retired);
+static void _trmEpochRetiredFree(struct TrmEpochRetired_T* retired)
+{
+    while (retired != NULL)
+    {
+        struct TrmEpochRetired_T* next = retired->next;
+
+        retired->pProc(retired->pObject, retired->pParam);
+        free(retired);
+
+        retired = next;
+    }
+}
+
+static void _trmEpochReclaim(struct TrmEpochRecord_T* record);
+static void _trmEpochReclaim(struct TrmEpochRecord_T* record)
+{
+    uint64_t epoch = _trmEpochAdvance();
+
+    if (record != NULL)
+        _trmEpochRetiredFree(_trmEpochExpiredCut(&record->limboHead, &record->limboTail, &record->limboCount, epoch));
+
+    TRM_MUTEX_LOCK(&_trmEpochLock);
+    struct TrmEpochRetired_T* expired = _trmEpochExpiredCut(&_trmEpochOrphanHead, &_trmEpochOrphanTail, &_trmEpochOrphanCount, epoch);
+    TRM_MUTEX_UNLOCK(&_trmEpochLock);
+
+    _trmEpochRetiredFree(expired); // outside of the lock, the functions may retire more objects
+}
+
+static void _trmEpochBufferFree(void* pObject, void* pParam);
+static void _trmEpochBufferFree(void* pObject, void* pParam)
+{
+    trmFree((TrmBuffer)pObject, (TrmMemoryPool)pParam);
+}
+
+/* -------------------- *
+ *   CHANGE             *
+ * -------------------- */
+
+void trmEpochEnter(void)
+{
+    struct TrmEpochRecord_T* record = _trmEpochRecordGet();
+
+    if (record->nesting++ > 0)
+        return;
+
+    // a plain store and a fence instead of a read-modify-write, this is the path every read takes. The fence keeps the reads of the critical
+    // section from happening before the other threads can see the announcement
+    TRM_ATOMIC_STORE64(&record->announced, (TRM_ATOMIC_LOAD64(&_trmGlobalEpoch) << 1) | 1);
+    TRM_ATOMIC_FENCE();
+}
+
+void trmEpochExit(void)
+{
+    struct TrmEpochRecord_T* record = &TRM_THREAD_CONTEXT->epochRecord;
+
+    if (record->nesting == 0)
+        return;
+
+    record->nesting--;
+    if (record->nesting == 0)
+        TRM_ATOMIC_STORE64(&record->announced, 0);
+}
+
+void trmEpochRetire(void* pObject, TrmReclaimProcess pProc, void* pParam)
+{
+    struct TrmEpochRecord_T* record = _trmEpochRecordGet();
+    struct TrmEpochRetired_T* retired = malloc(sizeof(struct TrmEpochRetired_T));
+
+    if (retired == NULL) // out of memory. The object is leaked, as freeing it now could pull it from under a reader
+        return;
+
+    retired->pObject = pObject;
+    retired->pProc = pProc;
+    retired->pParam = pParam;
+    retired->epoch = TRM_ATOMIC_LOAD64(&_trmGlobalEpoch);
+    retired->next = NULL;
+
+    if (record->limboTail != NULL)
+        record->limboTail->next = retired;
+    else
+        record->limboHead = retired;
+    record->limboTail = retired;
+    record->limboCount++;
+
+    if (record->limboCount % TRM_EPOCH_BATCH_SIZE == 0)
+        _trmEpochReclaim(record);
+}
+
+void trmEpochRetireBuffer(TrmBuffer hBuffer, TrmMemoryPool hMemoryPool)
+{
+    trmEpochRetire(hBuffer, _trmEpochBufferFree, hMemoryPool);
+}
+
+void trmEpochFlush(void)
+{
+    struct TrmEpochRecord_T* record = &TRM_THREAD_CONTEXT->epochRecord;
+
+    // what was retired last can be freed once the epoch has moved twice
+    _trmEpochReclaim((record->isRegistered == true) ? record : NULL);
+    _trmEpochReclaim((record->isRegistered == true) ? record : NULL);
+}
+
+/* -------------------- *
+ *   DESTROY            *
+ * -------------------- */
+
+void trmEpochThreadUnregister(void)
+{
+    struct TrmEpochRecord_T* record = &TRM_THREAD_CONTEXT->epochRecord;
+
+    if (record->isRegistered == false)
+        return;
+
+    TRM_ATOMIC_STORE64(&record->announced, 0);
+    record->nesting = 0;
+
+    _trmEpochReclaim(record);
+
+    TRM_MUTEX_LOCK(&_trmEpochLock);
+    if (record->previous != NULL)
+        record->previous->next = record->next;
+    else
+        _trmEpochRecords = record->next;
+    if (record->next != NULL)
+        record->next->previous = record->previous;
+
+    if (record->limboHead != NULL) // the rest is left to the threads that are still running
+    {
+        if (_trmEpochOrphanTail != NULL)
+            _trmEpochOrphanTail->next = record->limboHead;
+        else
+            _trmEpochOrphanHead = record->limboHead;
+        _trmEpochOrphanTail = record->limboTail;
+        _trmEpochOrphanCount += record->limboCount;
+    }
+    TRM_MUTEX_UNLOCK(&_trmEpochLock);
+
+    record->limboHead = NULL;
+    record->limboTail = NULL;
+    record->limboCount = 0;
+    record->isRegistered = false;
+}
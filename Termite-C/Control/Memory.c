@@ -16,16 +16,179 @@
 #include "../Internal.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+    #define TRM_ASAN
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define TRM_ASAN
+    #endif
+#endif
+
+// with ASan, the redzones and quarantined buffers of debug pools are also poisoned, so bad accesses are caught as they happen instead of at the next check
+#ifdef TRM_ASAN
+    #include <sanitizer/asan_interface.h>
+    #define TRM_ASAN_POISON(address, size)   ASAN_POISON_MEMORY_REGION(address, size)
+    #define TRM_ASAN_UNPOISON(address, size) ASAN_UNPOISON_MEMORY_REGION(address, size)
+#else
+    #define TRM_ASAN_POISON(address, size)   ((void)(address), (void)(size))
+    #define TRM_ASAN_UNPOISON(address, size) ((void)(address), (void)(size))
+#endif
+
+#define TRM_REDZONE_SIZE 16 // in bytes, the size of the redzones around the chunks of debug pools
+#define TRM_REDZONE_BYTE 0xFD // what redzones are filled with
+#define TRM_FREED_BYTE   0xDD // what quarantined buffers are filled with
+#define TRM_FREED_SIZE   256 // in bytes, how much of the start and of the end of every chunk of a quarantined buffer is filled in pools with TRM_MEMORY_POOL_DEBUG_BOUNDED_BIT
 
 /* -------------------- *
  *       INTERNAL       *
  * -------------------- */
 
+// host memory of blocks is page aligned, so that aligned chunks don't waste memory at the start of the block
+static void* _trmPageAlloc(uint64_t size);
+static void* _trmPageAlloc(uint64_t size)
+{
+#ifdef _WIN32
+    void* memory = _aligned_malloc(size, TRM_PAGE_SIZE);
+#else
+    void* memory = aligned_alloc(TRM_PAGE_SIZE, TRM_ALIGN_UP(size, TRM_PAGE_SIZE)); // aligned_alloc wants the size to be a multiple of the alignment
+#endif
+
+    if (memory != NULL)
+        memset(memory, 0, size); // same as before, the memory starts as zeroes
+
+    return memory;
+}
+
+static void _trmPageFree(void* memory);
+static void _trmPageFree(void* memory)
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+static void _trmBlockSlotsInit(struct TrmMemoryBlock_T* pMemoryBlock);
+static void _trmBlockSlotsInit(struct TrmMemoryBlock_T* pMemoryBlock)
+{
+    pMemoryBlock->slots[0] = 0;
+    pMemoryBlock->slots[1] = pMemoryBlock->size; // the first slot of a newly created block is the whole block
+
+    for (int i = 1; i < TRM_MAX_ITEM_COUNT; i++)
+    {
+        pMemoryBlock->slots[2 * i] = 1;
+        pMemoryBlock->slots[2 * i + 1] = 0; // slots[2*i] > slots[2*i + 1], which means that the slot is unused.
+    }
+}
+
+// gives the bytes in [start, end) back to the block, merging them with the slots right before and after them, if there are any.
+static void _trmBlockSlotRelease(struct TrmMemoryBlock_T* pMemoryBlock, uint64_t start, uint64_t end);
+static void _trmBlockSlotRelease(struct TrmMemoryBlock_T* pMemoryBlock, uint64_t start, uint64_t end)
+{
+    if (start >= end)
+        return;
+
+    int before = -1;
+    int after = -1;
+    int unused = -1;
+    int smallest = 0;
+    for (int j = 0; j < TRM_MAX_ITEM_COUNT; j++)
+    {
+        if (pMemoryBlock->slots[2 * j] >= pMemoryBlock->slots[2 * j + 1])
+        {
+            if (unused < 0)
+                unused = j;
+            continue;
+        }
+
+        if (pMemoryBlock->slots[2 * j + 1] == start)
+            before = j;
+        else if (pMemoryBlock->slots[2 * j] == end)
+            after = j;
+
+        if ((pMemoryBlock->slots[2 * j + 1] - pMemoryBlock->slots[2 * j]) < (pMemoryBlock->slots[2 * smallest + 1] - pMemoryBlock->slots[2 * smallest]))
+            smallest = j;
+    }
+
+    // if there's no unused slot, the memory is lost, like explained in TrmMemoryBlock_T.
+    // To lose as little as possible, the smallest slot gives its place to the new one, if the new one is bigger.
+    if ((unused < 0) && ((end - start) > (pMemoryBlock->slots[2 * smallest + 1] - pMemoryBlock->slots[2 * smallest])))
+        unused = smallest;
+
+    if ((before >= 0) && (after >= 0))
+    {
+        pMemoryBlock->slots[2 * before + 1] = pMemoryBlock->slots[2 * after + 1];
+        pMemoryBlock->slots[2 * after] = 1;
+        pMemoryBlock->slots[2 * after + 1] = 0;
+    }
+    else if (before >= 0)
+        pMemoryBlock->slots[2 * before + 1] = end;
+    else if (after >= 0)
+        pMemoryBlock->slots[2 * after] = start;
+    else if (unused >= 0)
+    {
+        pMemoryBlock->slots[2 * unused] = start;
+        pMemoryBlock->slots[2 * unused + 1] = end;
+    }
+}
+
+// searches for the slot that can give the most bytes to a chunk starting at a multiple of `alignment` and ending at a multiple of `endAlignment`,
+// with `redzone` bytes free on both of its sides. Returns -1 if no slot can be used.
+// The alignments are of the addresses, not of the offsets, since mapped device memory is only aligned to the device's minMemoryMapAlignment.
+// Unmapped device memory has no address, so there it's the offsets in the device buffer that are aligned.
+static int _trmBlockSlotBestFind(struct TrmMemoryBlock_T* pMemoryBlock, uint64_t alignment, uint64_t endAlignment, uint64_t redzone, uint64_t* pStart, uint64_t* pAvailable);
+static int _trmBlockSlotBestFind(struct TrmMemoryBlock_T* pMemoryBlock, uint64_t alignment, uint64_t endAlignment, uint64_t redzone, uint64_t* pStart, uint64_t* pAvailable)
+{
+    int bestSlot = -1;
+    *pAvailable = 0;
+
+    uint64_t base = (uint64_t)(uintptr_t)pMemoryBlock->startingAddress;
+    for (int j = 0; j < TRM_MAX_ITEM_COUNT; j++)
+    {
+        uint64_t start = TRM_ALIGN_UP(base + pMemoryBlock->slots[2 * j] + redzone, alignment);
+        uint64_t end = TRM_ALIGN_DOWN(base + pMemoryBlock->slots[2 * j + 1], endAlignment);
+
+        // this also skips unused slots, as for them slots[2*j] > slots[2*j + 1]
+        if ((end <= start + redzone) || ((end - start - redzone) <= *pAvailable))
+            continue;
+
+        bestSlot = j;
+        *pStart = start - base;
+        *pAvailable = end - start - redzone;
+    }
+
+    return bestSlot;
+}
+
+// takes `reserved` bytes starting at `start` out of a slot. The padding needed for the alignment (the bytes between the start of the slot and `start`)
+// is not wasted, but becomes a slot of its own.
+static void _trmBlockSlotTake(struct TrmMemoryBlock_T* pMemoryBlock, int slot, uint64_t start, uint64_t reserved);
+static void _trmBlockSlotTake(struct TrmMemoryBlock_T* pMemoryBlock, int slot, uint64_t start, uint64_t reserved)
+{
+    uint64_t slotStart = pMemoryBlock->slots[2 * slot];
+
+    pMemoryBlock->slots[2 * slot] = start + reserved;
+    if (pMemoryBlock->slots[2 * slot] >= pMemoryBlock->slots[2 * slot + 1])
+    {
+        pMemoryBlock->slots[2 * slot] = 1;
+        pMemoryBlock->slots[2 * slot + 1] = 0;
+    }
+
+    _trmBlockSlotRelease(pMemoryBlock, slotStart, start);
+}
+
 static int _trmBlockReserveMemory(struct TrmMemoryPoolInfo* pInfo, struct TrmMemoryBlock_T* pMemoryBlock);
 static int _trmBlockReserveMemory(struct TrmMemoryPoolInfo* pInfo, struct TrmMemoryBlock_T* pMemoryBlock)
 {
     if (pInfo->device == NULL)
-        pMemoryBlock->startingAddress = calloc(pMemoryBlock->size, sizeof(char)); // chars are 1 byte long. I think having the memory initialized as zeroes is a good idea.
+        pMemoryBlock->startingAddress = _trmPageAlloc(pMemoryBlock->size); // I think having the memory initialized as zeroes is a good idea.
     else
     {
         pMemoryBlock->hDevice = pInfo->device;
@@ -105,6 +268,7 @@ int _trmBufferChunkCreateCommandBuff(struct TrmBufferInfo* pInfo, struct TrmBuff
 
     if (vkAllocateCommandBuffers(pInfo->device, &commInfo, &pChunk->transferOp) != NULL)
         return TRM_VULKAN_DEVICE_COMMAND_CREATION_ERROR;
+    pChunk->hCommandPool = pInfo->commandPool;
 
     VkCommandBufferBeginInfo beginInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
@@ -133,41 +297,330 @@ int _trmBufferChunkCreateCommandBuff(struct TrmBufferInfo* pInfo, struct TrmBuff
     return TRM_SUCCESS;
 }
 
-/* -------------------- *
- *   INITIALIZE         *
- * -------------------- */
+static uint64_t _trmBlockHintCounter = 0; // hands out the block hints of the thread contexts
+static uint64_t _trmMemoryPoolIdCounter = 0; // hands out the ids of the pools
 
-TrmMemoryPool trmMemoryPoolCreate(struct TrmMemoryPoolInfo* pInfo)
+static void _trmMemoryPoolErrorSet(struct TrmMemoryPool_T* pMemoryPool, int error);
+static void _trmMemoryPoolErrorSet(struct TrmMemoryPool_T* pMemoryPool, int error)
 {
-    struct TrmMemoryPool_T* memoryPool = calloc(1, sizeof(struct TrmMemoryPool_T));
+    if ((pMemoryPool->flags & TRM_MEMORY_POOL_CONCURRENT_BIT) != 0)
+    {
+        struct TrmMemoryPoolError_T* poolError = &TRM_THREAD_CONTEXT->memoryErrors[pMemoryPool->id % TRM_MAX_ITEM_COUNT];
+        poolError->poolId = pMemoryPool->id;
+        poolError->error = error;
+    }
+    else
+        pMemoryPool->error = error;
+}
 
-    if (memoryPool == NULL)
-        return NULL;
+static void _trmMemoryBlockDestroy(struct TrmMemoryBlock_T* pMemoryBlock);
+static void _trmMemoryBlockDestroy(struct TrmMemoryBlock_T* pMemoryBlock)
+{
+    if (pMemoryBlock->hDevice == NULL)
+    {
+        TRM_ASAN_UNPOISON(pMemoryBlock->startingAddress, pMemoryBlock->size);
+        _trmPageFree(pMemoryBlock->startingAddress);
+    }
+    else
+    {
+        if ((pMemoryBlock->startingAddress != NULL) && (pMemoryBlock->hMemoryHandle != NULL))
+            vkUnmapMemory(pMemoryBlock->hDevice, pMemoryBlock->hMemoryHandle);
 
-    memoryPool->size = pInfo->size * 4; // transform from 4-byte words to bytes
-    memoryPool->used = 0;
-    memoryPool->error = TRM_SUCCESS;
+        if (pMemoryBlock->miniBuff != NULL)
+            free(pMemoryBlock->miniBuff);
 
+        if (pMemoryBlock->hMemoryHandle != NULL)
+            vkFreeMemory(pMemoryBlock->hDevice, pMemoryBlock->hMemoryHandle, NULL);
+
+        if (pMemoryBlock->hBufferHandle != NULL)
+            vkDestroyBuffer(pMemoryBlock->hDevice, pMemoryBlock->hBufferHandle, NULL);
+    }
+    TRM_MUTEX_DESTROY(&pMemoryBlock->lock);
+    free(pMemoryBlock);
+}
+
+// returns NULL if the block couldn't be made. The error is reported by the pool, and earlier errors are only ever replaced by new ones, never cleared
+static struct TrmMemoryBlock_T* _trmMemoryBlockCreate(struct TrmMemoryPoolInfo* pInfo, struct TrmMemoryPool_T* pMemoryPool);
+static struct TrmMemoryBlock_T* _trmMemoryBlockCreate(struct TrmMemoryPoolInfo* pInfo, struct TrmMemoryPool_T* pMemoryPool)
+{
     struct TrmMemoryBlock_T* block = calloc(1, sizeof(struct TrmMemoryBlock_T));
     if (block == NULL)
     {
-        memoryPool->error = TRM_MEMORY_UNAVAILABLE_BLOCKS_ERROR;
-        return (TrmMemoryPool)memoryPool;
+        _trmMemoryPoolErrorSet(pMemoryPool, TRM_MEMORY_UNAVAILABLE_BLOCKS_ERROR);
+        return NULL;
     }
 
     block->size = pInfo->size * 4; // transform from 4-byte words to bytes
     block->used = 0;
     block->next = NULL;
+    TRM_MUTEX_INIT(&block->lock);
 
-    block->slots[0] = 0;
-    block->slots[1] = block->size; // the first slot of a newly created block is the whole block
+    _trmBlockSlotsInit(block);
 
-    for (int i = 1; i < TRM_MAX_ITEM_COUNT; i++)
-        block->slots[2 * i] = 1; // slots[2*i + 1] = 0, which means that the slot is marked as used.
+    int error = _trmBlockReserveMemory(pInfo, block);
+    if (error != TRM_SUCCESS)
+    {
+        _trmMemoryPoolErrorSet(pMemoryPool, error);
+        _trmMemoryBlockDestroy(block);
+        return NULL;
+    }
+
+    return block;
+}
+
+// takes as many chunks as the block can give to the buffer (and the buffer can hold). Returns how many bytes were taken from the block.
+static uint64_t _trmBlockChunksTake(struct TrmMemoryBlock_T* pMemoryBlock, struct TrmBufferInfo* pBufferInfo, struct TrmBuffer_T* pBuffer, int* pChunkCount,
+    uint64_t* pRemainingSize, uint64_t alignment, uint64_t endAlignment, uint64_t redzone, struct TrmMemoryPool_T* pMemoryPool);
+static uint64_t _trmBlockChunksTake(struct TrmMemoryBlock_T* pMemoryBlock, struct TrmBufferInfo* pBufferInfo, struct TrmBuffer_T* pBuffer, int* pChunkCount,
+    uint64_t* pRemainingSize, uint64_t alignment, uint64_t endAlignment, uint64_t redzone, struct TrmMemoryPool_T* pMemoryPool)
+{
+    uint64_t reservedSize = 0;
+    while ((*pRemainingSize > 0) && (*pChunkCount < TRM_MAX_ITEM_COUNT) && (pMemoryBlock->used < pMemoryBlock->size))
+    {
+        // search for the best slot (AKA the slot with the biggest size so as to minimize the amount of chunks needed for a buffer)
+        uint64_t start = 0;
+        uint64_t available = 0;
+        int bestSlot = _trmBlockSlotBestFind(pMemoryBlock, alignment, endAlignment, redzone, &start, &available);
+        if (bestSlot < 0)
+            break;
+
+        struct TrmBufferChunk_T* chunk = &pBuffer->chunks[*pChunkCount];
+        chunk->associatedBlock = pMemoryBlock;
+
+        // the process remains unchanged even if we are dealing with unmapped device memory.
+        // The command buffer will simply use the offsets of the chunks to emulate the structure of the memory pool.
+        chunk->size = (*pRemainingSize > available) ? available : *pRemainingSize;
+        chunk->offset = start;
+        chunk->reserved = TRM_ALIGN_UP(chunk->size + redzone, endAlignment);
+        chunk->padding = 0;
+        if (redzone > 0) // the redzone in front grows to cover the alignment padding, instead of leaving tiny slots behind that would fill the slot table
+            chunk->padding = start - pMemoryBlock->slots[2 * bestSlot];
+        *pRemainingSize -= chunk->size;
+
+        if (pMemoryBlock->hDevice != NULL)
+        {
+            VkEventCreateInfo eventInfo = {
+                .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
+                .pNext = NULL,
+            };
+            vkCreateEvent(pMemoryBlock->hDevice, &eventInfo, NULL, &chunk->hostCanGetNextPart);
+
+            bool isConcurrent = (pMemoryPool->flags & TRM_MEMORY_POOL_CONCURRENT_BIT) != 0;
+            if (isConcurrent == true)
+                TRM_MUTEX_LOCK(&pMemoryPool->expandLock);
+
+            int error = _trmBufferChunkCreateCommandBuff(pBufferInfo, chunk);
+            if (error != TRM_SUCCESS)
+                _trmMemoryPoolErrorSet(pMemoryPool, error);
+
+            if (isConcurrent == true)
+                TRM_MUTEX_UNLOCK(&pMemoryPool->expandLock);
+        }
+
+        _trmBlockSlotTake(pMemoryBlock, bestSlot, chunk->offset - chunk->padding, chunk->padding + chunk->reserved);
+        pMemoryBlock->used += chunk->padding + chunk->reserved;
+        reservedSize += chunk->padding + chunk->reserved;
+        (*pChunkCount)++;
+    }
+
+    return reservedSize;
+}
+
+// gives the memory of a buffer back to its blocks. The handle itself is left to the caller
+static void _trmBufferRelease(struct TrmBuffer_T* pBuffer, struct TrmMemoryPool_T* pMemoryPool);
+static void _trmBufferRelease(struct TrmBuffer_T* pBuffer, struct TrmMemoryPool_T* pMemoryPool)
+{
+    bool isConcurrent = (pMemoryPool->flags & TRM_MEMORY_POOL_CONCURRENT_BIT) != 0;
+
+    uint64_t reservedSize = 0;
+    for (int i = 0; i < TRM_MAX_ITEM_COUNT; i++)
+    {
+        struct TrmBufferChunk_T* chunk = &pBuffer->chunks[i];
+        if (chunk->associatedBlock == NULL)
+            break;
+
+        if (chunk->transferOp != NULL)
+        {
+            if (isConcurrent == true)
+                TRM_MUTEX_LOCK(&pMemoryPool->expandLock);
+
+            vkFreeCommandBuffers(chunk->associatedBlock->hDevice, chunk->hCommandPool, 1, &chunk->transferOp);
+
+            if (isConcurrent == true)
+                TRM_MUTEX_UNLOCK(&pMemoryPool->expandLock);
+        }
+        if (chunk->hostCanGetNextPart != NULL)
+            vkDestroyEvent(chunk->associatedBlock->hDevice, chunk->hostCanGetNextPart, NULL);
+
+        if (chunk->associatedBlock->startingAddress != NULL)
+            TRM_ASAN_UNPOISON((uint8_t*)chunk->associatedBlock->startingAddress + chunk->offset - chunk->padding, chunk->padding + chunk->reserved);
+
+        if (isConcurrent == true)
+            TRM_MUTEX_LOCK(&chunk->associatedBlock->lock);
+
+        _trmBlockSlotRelease(chunk->associatedBlock, chunk->offset - chunk->padding, chunk->offset + chunk->reserved);
+        chunk->associatedBlock->used -= chunk->padding + chunk->reserved;
+        if (chunk->associatedBlock->used == 0) // an empty block gets back whatever memory was lost because its slots were full
+            _trmBlockSlotsInit(chunk->associatedBlock);
+
+        if (isConcurrent == true)
+            TRM_MUTEX_UNLOCK(&chunk->associatedBlock->lock);
+
+        reservedSize += chunk->padding + chunk->reserved;
+    }
+
+    TRM_ATOMIC_ADD64(&pMemoryPool->used, 0 - reservedSize);
+}
+
+// keeps the handle of a buffer of a debug pool, marked as freed, instead of freeing it. Must be called with debugLock held
+static void _trmBufferHandleKeep(struct TrmBuffer_T* pBuffer, struct TrmMemoryPool_T* pMemoryPool);
+static void _trmBufferHandleKeep(struct TrmBuffer_T* pBuffer, struct TrmMemoryPool_T* pMemoryPool)
+{
+    pBuffer->isFreed = true;
+    pBuffer->previous = NULL;
+    pBuffer->next = NULL;
+
+    if (pMemoryPool->freedTail != NULL)
+        pMemoryPool->freedTail->next = pBuffer;
+    else
+        pMemoryPool->freedHead = pBuffer;
+    pMemoryPool->freedTail = pBuffer;
+    pMemoryPool->freedCount++;
+}
+
+// takes the oldest kept handle of a debug pool, or allocates a new one. Handles are only reused once TRM_MAX_ITEM_COUNT of them are kept,
+// so that a double free is still caught for a while after its buffer left the quarantine
+static struct TrmBuffer_T* _trmBufferHandleTake(struct TrmMemoryPool_T* pMemoryPool);
+static struct TrmBuffer_T* _trmBufferHandleTake(struct TrmMemoryPool_T* pMemoryPool)
+{
+    struct TrmBuffer_T* buffer = NULL;
+
+    TRM_MUTEX_LOCK(&pMemoryPool->debugLock);
+    if (pMemoryPool->freedCount > TRM_MAX_ITEM_COUNT)
+    {
+        buffer = pMemoryPool->freedHead;
+        pMemoryPool->freedHead = buffer->next;
+        pMemoryPool->freedCount--;
+    }
+    TRM_MUTEX_UNLOCK(&pMemoryPool->debugLock);
+
+    if (buffer == NULL)
+        return calloc(1, sizeof(struct TrmBuffer_T));
+
+    memset(buffer, 0, sizeof(struct TrmBuffer_T));
+    return buffer;
+}
+
+// checks that every byte of [pStart, pStart + size) is `value`. If the first byte is, comparing the memory with itself shifted by a byte
+// checks the rest, and memcmp does that many bytes at a time
+static bool _trmMemoryIsFilled(const uint8_t* pStart, uint64_t size, uint8_t value);
+static bool _trmMemoryIsFilled(const uint8_t* pStart, uint64_t size, uint8_t value)
+{
+    if (size == 0)
+        return true;
+
+    return (pStart[0] == value) && (memcmp(pStart, pStart + 1, size - 1) == 0);
+}
+
+// fills the redzones of a buffer, or checks them if `check` is true. Either way, the redzones are left poisoned.
+static int _trmBufferRedzonesApply(struct TrmBuffer_T* pBuffer, bool check);
+static int _trmBufferRedzonesApply(struct TrmBuffer_T* pBuffer, bool check)
+{
+    int error = TRM_SUCCESS;
+    for (int i = 0; i < TRM_MAX_ITEM_COUNT; i++)
+    {
+        struct TrmBufferChunk_T* chunk = &pBuffer->chunks[i];
+        if (chunk->associatedBlock == NULL)
+            break;
+        if (chunk->associatedBlock->startingAddress == NULL) // unmapped device memory can't have redzones
+            continue;
+
+        uint8_t* front = (uint8_t*)chunk->associatedBlock->startingAddress + chunk->offset - chunk->padding;
+        uint8_t* back = (uint8_t*)chunk->associatedBlock->startingAddress + chunk->offset + chunk->size;
+        uint64_t backSize = chunk->reserved - chunk->size;
+
+        TRM_ASAN_UNPOISON(front, chunk->padding);
+        TRM_ASAN_UNPOISON(back, backSize);
+
+        if (check == false)
+        {
+            memset(front, TRM_REDZONE_BYTE, chunk->padding);
+            memset(back, TRM_REDZONE_BYTE, backSize);
+        }
+        else if ((_trmMemoryIsFilled(front, chunk->padding, TRM_REDZONE_BYTE) == false) || (_trmMemoryIsFilled(back, backSize, TRM_REDZONE_BYTE) == false))
+            error = TRM_MEMORY_CORRUPTION_ERROR;
+
+        TRM_ASAN_POISON(front, chunk->padding);
+        TRM_ASAN_POISON(back, backSize);
+    }
+
+    return error;
+}
+
+// fills every chunk of a freed buffer with TRM_FREED_BYTE, or checks that they still are if `check` is true. If `isBounded` is true, only the
+// first and last TRM_FREED_SIZE bytes of every chunk are, but the whole chunk is still left poisoned, so with ASan, writes to its middle are caught too.
+static int _trmBufferFreedApply(struct TrmBuffer_T* pBuffer, bool check, bool isBounded);
+static int _trmBufferFreedApply(struct TrmBuffer_T* pBuffer, bool check, bool isBounded)
+{
+    int error = TRM_SUCCESS;
+    for (int i = 0; i < TRM_MAX_ITEM_COUNT; i++)
+    {
+        struct TrmBufferChunk_T* chunk = &pBuffer->chunks[i];
+        if (chunk->associatedBlock == NULL)
+            break;
+        if (chunk->associatedBlock->startingAddress == NULL)
+            continue;
+
+        uint8_t* start = (uint8_t*)chunk->associatedBlock->startingAddress + chunk->offset;
+        uint64_t headSize = ((isBounded == false) || (chunk->size < TRM_FREED_SIZE)) ? chunk->size : TRM_FREED_SIZE;
+        uint64_t tailStart = (chunk->size - headSize > TRM_FREED_SIZE) ? chunk->size - TRM_FREED_SIZE : headSize; // the two ends never overlap
+        uint64_t tailSize = chunk->size - tailStart;
+
+        TRM_ASAN_UNPOISON(start, headSize);
+        TRM_ASAN_UNPOISON(start + tailStart, tailSize);
+
+        if (check == false)
+        {
+            memset(start, TRM_FREED_BYTE, headSize);
+            memset(start + tailStart, TRM_FREED_BYTE, tailSize);
+        }
+        else if ((_trmMemoryIsFilled(start, headSize, TRM_FREED_BYTE) == false) || (_trmMemoryIsFilled(start + tailStart, tailSize, TRM_FREED_BYTE) == false))
+            error = TRM_MEMORY_USE_AFTER_FREE_ERROR;
+
+        TRM_ASAN_POISON(start, chunk->size);
+    }
+
+    return error;
+}
 
-    memoryPool->error = _trmBlockReserveMemory(pInfo, block);
+/* -------------------- *
+ *   INITIALIZE         *
+ * -------------------- */
 
-    memoryPool->firstBlock = block;
+TrmMemoryPool trmMemoryPoolCreate(struct TrmMemoryPoolInfo* pInfo)
+{
+    struct TrmMemoryPool_T* memoryPool = calloc(1, sizeof(struct TrmMemoryPool_T));
+
+    if (memoryPool == NULL)
+        return NULL;
+
+    memoryPool->size = pInfo->size * 4; // transform from 4-byte words to bytes
+    memoryPool->used = 0;
+    memoryPool->flags = pInfo->flags;
+    memoryPool->error = TRM_SUCCESS;
+    memoryPool->id = TRM_ATOMIC_ADD64(&_trmMemoryPoolIdCounter, 1) + 1;
+    TRM_MUTEX_INIT(&memoryPool->expandLock);
+    TRM_MUTEX_INIT(&memoryPool->debugLock);
+
+    memoryPool->firstBlock = _trmMemoryBlockCreate(pInfo, memoryPool);
+    if (memoryPool->firstBlock == NULL) // the rest of the pool expects at least one block, so a pool without one is no pool at all
+    {
+        TRM_MUTEX_DESTROY(&memoryPool->expandLock);
+        TRM_MUTEX_DESTROY(&memoryPool->debugLock);
+        free(memoryPool);
+        return NULL;
+    }
+    memoryPool->blockCount = 1;
 
     return (TrmMemoryPool)memoryPool;
 }
@@ -178,7 +631,11 @@ TrmMemoryPool trmMemoryPoolCreate(struct TrmMemoryPoolInfo* pInfo)
 
 void trmMemoryPoolExpand(struct TrmMemoryPoolInfo* pInfo, TrmMemoryPool hMemoryPool)
 {
-    TRM_MEMORY_POOL->size += pInfo->size * 4; // transform from 4-byte words to bytes
+    struct TrmMemoryBlock_T* newBlock = _trmMemoryBlockCreate(pInfo, TRM_MEMORY_POOL);
+    if (newBlock == NULL)
+        return;
+
+    TRM_MUTEX_LOCK(&TRM_MEMORY_POOL->expandLock);
 
     struct TrmMemoryBlock_T* block = TRM_MEMORY_POOL->firstBlock;
     while (block->next != NULL)
@@ -187,106 +644,225 @@ void trmMemoryPoolExpand(struct TrmMemoryPoolInfo* pInfo, TrmMemoryPool hMemoryP
         continue;
     }
 
-    struct TrmMemoryBlock_T* newBlock = calloc(1, sizeof(struct TrmMemoryBlock_T));
-    if (newBlock == NULL)
-    {
-        TRM_MEMORY_POOL->error = TRM_MEMORY_UNAVAILABLE_BLOCKS_ERROR;
-        return;
-    }
-
-    newBlock->size = pInfo->size * 4; // transform from 4-byte words to bytes
-    newBlock->used = 0;
-    newBlock->next = NULL;
+    // the block is complete before it's linked, so threads walking the list never see it half made
+    TRM_ATOMIC_STORE_PTR(&block->next, newBlock);
+    TRM_ATOMIC_ADD64(&TRM_MEMORY_POOL->blockCount, 1);
+    TRM_ATOMIC_ADD64(&TRM_MEMORY_POOL->size, pInfo->size * 4); // transform from 4-byte words to bytes
 
-    newBlock->slots[0] = 0;
-    newBlock->slots[1] = block->size; // the first slot of a newly created block is the whole block
-
-    for (int i = 1; i < TRM_MAX_ITEM_COUNT; i++)
-        block->slots[2 * i] = 1; // slots[2*i + 1] = 0, which means that the slot is marked as used.
-
-    TRM_MEMORY_POOL->error = _trmBlockReserveMemory(pInfo, newBlock);
-
-    block->next = newBlock;
+    TRM_MUTEX_UNLOCK(&TRM_MEMORY_POOL->expandLock);
 }
 
 TrmBuffer trmAllocate(struct TrmBufferInfo* pBufferInfo, TrmMemoryPool hMemoryPool)
 {
+    if (pBufferInfo->size == 0)
+    {
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, TRM_GENERIC_INVALID_ARGUMENT_ERROR);
+        return NULL;
+    }
+
     // allocation happens this way: Termite checks if a memory block has available space. If it has,
     // then it will start filling chunks, up to TRM_MAX_ITEM_COUNT. Each chunk's size depends on how big
     // the slots of available memory in each block of the memory pool are.
-    if (TRM_MEMORY_POOL->used >= TRM_MEMORY_POOL->size)
+    if (TRM_ATOMIC_LOAD64(&TRM_MEMORY_POOL->used) >= TRM_ATOMIC_LOAD64(&TRM_MEMORY_POOL->size))
     {
-        TRM_MEMORY_POOL->error = TRM_MEMORY_OOM_ERROR;
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, TRM_MEMORY_OOM_ERROR);
         return NULL;
     }
 
-    struct TrmBuffer_T* buffer = calloc(1, sizeof(struct TrmBuffer_T));
+    uint64_t alignment = (pBufferInfo->alignment == 0) ? 4 : pBufferInfo->alignment;
+    if (((alignment & (alignment - 1)) != 0) || (alignment > TRM_PAGE_SIZE))
+    {
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, TRM_MEMORY_INVALID_ALIGNMENT_ERROR);
+        return NULL;
+    }
+
+    // a buffer that mustn't share cache lines starts at a cache line and takes whole cache lines only.
+    // The padding at its end still belongs to it, so nothing else can be placed there.
+    bool separateCacheLine = (pBufferInfo->flags & TRM_BUFFER_SEPARATE_CACHE_LINE_BIT) != 0;
+    if ((separateCacheLine == true) && (alignment < TRM_CACHE_LINE_SIZE))
+        alignment = TRM_CACHE_LINE_SIZE;
+    uint64_t endAlignment = (separateCacheLine == true) ? TRM_CACHE_LINE_SIZE : 1;
+
+    bool isDebug = (TRM_MEMORY_POOL->flags & TRM_MEMORY_POOL_DEBUG_BIT) != 0;
+    uint64_t redzone = (isDebug == true) ? TRM_REDZONE_SIZE : 0;
+
+    struct TrmBuffer_T* buffer = (isDebug == true) ? _trmBufferHandleTake(TRM_MEMORY_POOL) : calloc(1, sizeof(struct TrmBuffer_T));
     if (buffer == NULL)
     {
-        TRM_MEMORY_POOL->error = TRM_GENERIC_OOM_ERROR;
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, TRM_GENERIC_OOM_ERROR);
         return NULL;
     }
 
-    uint64_t remainingSize = pBufferInfo->size;
-    for (int i = 0; i < TRM_MAX_ITEM_COUNT; i++) // chunks
+    uint64_t remainingSize = pBufferInfo->size * 4; // transform from 4-byte words to bytes
+    uint64_t reservedSize = 0;
+    int chunkCount = 0;
+
+    bool isConcurrent = (TRM_MEMORY_POOL->flags & TRM_MEMORY_POOL_CONCURRENT_BIT) != 0;
+    uint64_t blockCount = TRM_ATOMIC_LOAD64(&TRM_MEMORY_POOL->blockCount);
+
+    // in concurrent pools, every thread starts from a different block, so that threads don't all wait for the first one.
+    // Busy blocks are skipped in the first pass and waited for only in the second.
+    struct TrmMemoryBlock_T* firstBlock = TRM_MEMORY_POOL->firstBlock;
+    if ((isConcurrent == true) && (blockCount > 1))
     {
-        struct TrmMemoryBlock_T* block = TRM_MEMORY_POOL->firstBlock;
-        while (block != NULL)
-        {
-            if ((block->size - block->used) < buffer->size)
-            {
-                block = block->next;
-                continue;
-            }
+        struct TrmThreadContext_T* context = TRM_THREAD_CONTEXT;
+        if (context->blockHint == 0)
+            context->blockHint = TRM_ATOMIC_ADD64(&_trmBlockHintCounter, 1) + 1;
 
-            buffer->chunks[i].associatedBlock = block;
+        for (uint64_t i = 0; i < (context->blockHint % blockCount); i++)
+            firstBlock = TRM_ATOMIC_LOAD_PTR(&firstBlock->next);
+    }
 
-            int bestSlot = 0; // the first slot is set up when the memory pool is created
-            // search for the best slot (AKA the slot with the biggest size so as to minimize the amount of chunks needed for a buffer)
-            for (int j = 0; j < TRM_MAX_ITEM_COUNT; j++) // slots
+    for (int pass = 0; pass < ((isConcurrent == true) ? 2 : 1); pass++)
+    {
+        struct TrmMemoryBlock_T* block = firstBlock;
+        for (uint64_t i = 0; (i < blockCount) && (remainingSize > 0) && (chunkCount < TRM_MAX_ITEM_COUNT); i++)
+        {
+            bool isLocked = true;
+            if (isConcurrent == true)
             {
-                // if slots[2*j] > slots[2*j + 1], then the result is negative, hence always smaller 
-                // than the current best slot (even if it's 0 and filled, then it'd be - 1 > - 1 : false, hence no point in 
-                // changing the best slot index
-                if ((block->slots[2 * j + 1] - block->slots[2 * j]) > (block->slots[2 * bestSlot + 1] - block->slots[2 * bestSlot]))
-                    bestSlot = j;
+                if (pass == 0)
+                    isLocked = TRM_MUTEX_TRY_LOCK(&block->lock);
+                else
+                    TRM_MUTEX_LOCK(&block->lock);
             }
 
-            // the process remains unchanged even if we are dealing with unmapped device memory. 
-            // The command buffer will simply use the offsets of the chunks to emulate the structure of the memory pool.
-            buffer->chunks[i].size = (remainingSize > (block->slots[2 * bestSlot + 1] - block->slots[2 * bestSlot])) ? \
-                ((block->slots[2 * bestSlot + 1] - block->slots[2 * bestSlot]) * 4) : (remainingSize * 4);
-            buffer->chunks[i].offset = 4 * block->slots[2 * bestSlot];
-            remainingSize -= (remainingSize > (block->slots[2 * bestSlot + 1] - block->slots[2 * bestSlot])) ? \
-                (block->slots[2 * bestSlot + 1] - block->slots[2 * bestSlot]) : (remainingSize);
-
-            if (block->hDevice != NULL)
+            if (isLocked == true)
             {
-                VkEventCreateInfo eventInfo = {
-                    .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
-                    .pNext = NULL,
-                };
-                vkCreateEvent(block->hDevice, &eventInfo, NULL, &buffer->chunks[i].hostCanGetNextPart);
+                reservedSize += _trmBlockChunksTake(block, pBufferInfo, buffer, &chunkCount, &remainingSize, alignment, endAlignment, redzone, TRM_MEMORY_POOL);
 
-                TRM_MEMORY_POOL->error = _trmBufferChunkCreateCommandBuff(&buffer->chunks[i], block->hDevice);
+                if (isConcurrent == true)
+                    TRM_MUTEX_UNLOCK(&block->lock);
             }
 
-            block->slots[2 * bestSlot] += buffer->chunks[i].size;
-            block->used += buffer->chunks[i].size * 4;
+            block = TRM_ATOMIC_LOAD_PTR(&block->next);
+            if (block == NULL)
+                block = TRM_MEMORY_POOL->firstBlock;
         }
+    }
 
-        if (buffer->chunks[i].associatedBlock == NULL)
+    if (chunkCount == 0)
+    {
+        if (isDebug == true) // the handle may have been freed before, so it's kept for the same reason
         {
-            TRM_MEMORY_POOL->error = TRM_MEMORY_OOM_ERROR;
-            return NULL;
+            TRM_MUTEX_LOCK(&TRM_MEMORY_POOL->debugLock);
+            _trmBufferHandleKeep(buffer, TRM_MEMORY_POOL);
+            TRM_MUTEX_UNLOCK(&TRM_MEMORY_POOL->debugLock);
         }
+        else
+            free(buffer);
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, TRM_MEMORY_OOM_ERROR);
+        return NULL;
     }
 
-    TRM_MEMORY_POOL->used += (pBufferInfo->size - remainingSize) * 4; // it's possible that the buffer couldn't be fully allocated
+    if (remainingSize > 0)
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, TRM_MEMORY_OOM_ERROR); // it's possible that the buffer couldn't be fully allocated
+
+    buffer->size = pBufferInfo->size * 4 - remainingSize;
+    TRM_ATOMIC_ADD64(&TRM_MEMORY_POOL->used, reservedSize);
+
+    if (isDebug == true)
+    {
+        _trmBufferRedzonesApply(buffer, false);
+
+        TRM_MUTEX_LOCK(&TRM_MEMORY_POOL->debugLock);
+        buffer->next = TRM_MEMORY_POOL->liveBuffers;
+        if (buffer->next != NULL)
+            buffer->next->previous = buffer;
+        TRM_MEMORY_POOL->liveBuffers = buffer;
+        TRM_MUTEX_UNLOCK(&TRM_MEMORY_POOL->debugLock);
+    }
 
     return (TrmBuffer)buffer;
 }
 
+void trmFree(TrmBuffer hBuffer, TrmMemoryPool hMemoryPool)
+{
+    if (hBuffer == NULL)
+        return;
+
+    if ((TRM_MEMORY_POOL->flags & TRM_MEMORY_POOL_DEBUG_BIT) == 0)
+    {
+        _trmBufferRelease(TRM_BUFFER, TRM_MEMORY_POOL);
+        free(TRM_BUFFER);
+        return;
+    }
+
+    // in debug pools, the buffer waits in the quarantine, poisoned, before its memory can be used again.
+    // Whatever it pushes out of the quarantine must still be poisoned, or someone used it after freeing it.
+    bool isBounded = (TRM_MEMORY_POOL->flags & TRM_MEMORY_POOL_DEBUG_BOUNDED_BIT) != 0;
+    TRM_MUTEX_LOCK(&TRM_MEMORY_POOL->debugLock);
+
+    if (TRM_BUFFER->isFreed == true) // it's in the quarantine or its handle was kept, touching the lists again would corrupt them
+    {
+        TRM_MUTEX_UNLOCK(&TRM_MEMORY_POOL->debugLock);
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, TRM_MEMORY_DOUBLE_FREE_ERROR);
+        return;
+    }
+
+    int error = _trmBufferRedzonesApply(TRM_BUFFER, true);
+
+    if (TRM_BUFFER->previous != NULL)
+        TRM_BUFFER->previous->next = TRM_BUFFER->next;
+    else
+        TRM_MEMORY_POOL->liveBuffers = TRM_BUFFER->next;
+    if (TRM_BUFFER->next != NULL)
+        TRM_BUFFER->next->previous = TRM_BUFFER->previous;
+    TRM_BUFFER->previous = NULL;
+    TRM_BUFFER->next = NULL;
+    TRM_BUFFER->isFreed = true;
+
+    _trmBufferFreedApply(TRM_BUFFER, false, isBounded);
+
+    struct TrmBuffer_T* oldBuffer = TRM_MEMORY_POOL->quarantine[TRM_MEMORY_POOL->quarantineNext];
+    TRM_MEMORY_POOL->quarantine[TRM_MEMORY_POOL->quarantineNext] = TRM_BUFFER;
+    TRM_MEMORY_POOL->quarantineNext = (TRM_MEMORY_POOL->quarantineNext + 1) % TRM_MAX_ITEM_COUNT;
+
+    if ((oldBuffer != NULL) && (_trmBufferFreedApply(oldBuffer, true, isBounded) != TRM_SUCCESS) && (error == TRM_SUCCESS))
+        error = TRM_MEMORY_USE_AFTER_FREE_ERROR;
+
+    TRM_MUTEX_UNLOCK(&TRM_MEMORY_POOL->debugLock);
+
+    if (oldBuffer != NULL)
+    {
+        _trmBufferRelease(oldBuffer, TRM_MEMORY_POOL);
+
+        TRM_MUTEX_LOCK(&TRM_MEMORY_POOL->debugLock);
+        _trmBufferHandleKeep(oldBuffer, TRM_MEMORY_POOL);
+        TRM_MUTEX_UNLOCK(&TRM_MEMORY_POOL->debugLock);
+    }
+
+    if (error != TRM_SUCCESS)
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, error);
+}
+
+int trmMemoryPoolValidate(TrmMemoryPool hMemoryPool)
+{
+    if ((TRM_MEMORY_POOL->flags & TRM_MEMORY_POOL_DEBUG_BIT) == 0)
+        return TRM_SUCCESS;
+
+    int error = TRM_SUCCESS;
+    bool isBounded = (TRM_MEMORY_POOL->flags & TRM_MEMORY_POOL_DEBUG_BOUNDED_BIT) != 0;
+
+    TRM_MUTEX_LOCK(&TRM_MEMORY_POOL->debugLock);
+
+    for (struct TrmBuffer_T* buffer = TRM_MEMORY_POOL->liveBuffers; (buffer != NULL) && (error == TRM_SUCCESS); buffer = buffer->next)
+        error = _trmBufferRedzonesApply(buffer, true);
+
+    for (int i = 0; (i < TRM_MAX_ITEM_COUNT) && (error == TRM_SUCCESS); i++)
+    {
+        if (TRM_MEMORY_POOL->quarantine[i] != NULL)
+            error = _trmBufferFreedApply(TRM_MEMORY_POOL->quarantine[i], true, isBounded);
+    }
+
+    TRM_MUTEX_UNLOCK(&TRM_MEMORY_POOL->debugLock);
+
+    if (error != TRM_SUCCESS)
+        _trmMemoryPoolErrorSet(TRM_MEMORY_POOL, error);
+
+    return error;
+}
+
 /* -------------------- *
  *   GET & SET          *
  * -------------------- */
@@ -298,21 +874,17 @@ int trmMemoryPoolSizeGet(TrmMemoryPool hMemoryPool)
 
 inline int trmMemoryPoolBlockCountGet(TrmMemoryPool hMemoryPool)
 {
-    int blockCount = 1; // every memory pool has at least one block
-
-    struct TrmMemoryBlock_T* block = TRM_MEMORY_POOL->firstBlock;
-
-    while (block->next != NULL)
-    {
-        blockCount++;
-        block = block->next;
-    }
-
-    return blockCount;
+    return (int)TRM_ATOMIC_LOAD64(&TRM_MEMORY_POOL->blockCount);
 }
 
 int trmMemoryPoolErrorGet(TrmMemoryPool hMemoryPool)
 {
+    if ((TRM_MEMORY_POOL->flags & TRM_MEMORY_POOL_CONCURRENT_BIT) != 0)
+    {
+        struct TrmMemoryPoolError_T* poolError = &TRM_THREAD_CONTEXT->memoryErrors[TRM_MEMORY_POOL->id % TRM_MAX_ITEM_COUNT];
+        return (poolError->poolId == TRM_MEMORY_POOL->id) ? poolError->error : TRM_SUCCESS;
+    }
+
     return TRM_MEMORY_POOL->error;
 }
 
@@ -324,28 +896,26 @@ void trmMemoryPoolDestroy(TrmMemoryPool hMemoryPool)
 {
     // TODO: Check if the device is still using the memory pool. If it is, then wait for it to finish.
 
+    for (int i = 0; i < TRM_MAX_ITEM_COUNT; i++)
+        free(TRM_MEMORY_POOL->quarantine[i]); // their memory goes away with the blocks
+
+    struct TrmBuffer_T* freedBuffer = TRM_MEMORY_POOL->freedHead;
+    while (freedBuffer != NULL)
+    {
+        struct TrmBuffer_T* nextBuffer = freedBuffer->next;
+        free(freedBuffer);
+        freedBuffer = nextBuffer;
+    }
+
     struct TrmMemoryBlock_T* block = TRM_MEMORY_POOL->firstBlock;
     struct TrmMemoryBlock_T* nextBlock = NULL;
     while (block != NULL)
     {
         nextBlock = block->next;
-        if (block->hMemoryHandle == NULL)
-            free(block->startingAddress);
-        else
-        {
-            if (block->startingAddress != NULL)
-                vkUnmapMemory(block->hDevice, block->hMemoryHandle);
-
-            if (block->miniBuff != NULL)
-                free(block->miniBuff);
-
-            vkFreeMemory(block->hDevice, block->hMemoryHandle, NULL);
-
-            if (block->hBufferHandle != NULL)
-                vkDestroyBuffer(block->hDevice, block->hBufferHandle, NULL);
-        }
-        free(block);
+        _trmMemoryBlockDestroy(block);
         block = nextBlock;
     }
+    TRM_MUTEX_DESTROY(&TRM_MEMORY_POOL->expandLock);
+    TRM_MUTEX_DESTROY(&TRM_MEMORY_POOL->debugLock);
     free(TRM_MEMORY_POOL);
 }
@@ -1,6 +1,139 @@
 #include "../Internal.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+TRM_THREAD_LOCAL struct TrmThreadContext_T* _trmThreadContext = NULL;
+static TRM_THREAD_LOCAL struct TrmThreadContext_T _trmThreadContextStorage; // the context lives in the thread's own storage, so setting it up can't fail
+
+static TrmMutex                  _trmThreadLocalLock = TRM_MUTEX_INITIALIZER; // only one thread at a time can register thread locals
+static struct TrmThreadLocalInfo _trmThreadLocals[TRM_MAX_ITEM_COUNT];
+static uint64_t                  _trmThreadLocalCount = 0;
+
+// threads Termite didn't create don't go through _trmThreadStart, so the OS calls _trmThreadExitCallback when they finish instead
+#ifdef _WIN32
+static INIT_ONCE _trmThreadExitOnce = INIT_ONCE_STATIC_INIT;
+static DWORD     _trmThreadExitKey = FLS_OUT_OF_INDEXES;
+
+static VOID WINAPI _trmThreadExitCallback(PVOID pContext);
+static VOID WINAPI _trmThreadExitCallback(PVOID pContext)
+{
+    if (pContext != NULL)
+        _trmThreadContextDestroy();
+}
+
+static BOOL CALLBACK _trmThreadExitKeyCreate(PINIT_ONCE pOnce, PVOID pParam, PVOID* ppContext);
+static BOOL CALLBACK _trmThreadExitKeyCreate(PINIT_ONCE pOnce, PVOID pParam, PVOID* ppContext)
+{
+    _trmThreadExitKey = FlsAlloc(_trmThreadExitCallback);
+    return TRUE;
+}
+#else
+static pthread_once_t _trmThreadExitOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t  _trmThreadExitKey;
+static bool           _trmThreadExitKeyCreated = false;
+
+static void _trmThreadExitCallback(void* pContext);
+static void _trmThreadExitCallback(void* pContext)
+{
+    (void)pContext;
+    _trmThreadContextDestroy(); // thread locals are still there while keys are destroyed
+}
+
+static void _trmThreadExitKeyCreate(void);
+static void _trmThreadExitKeyCreate(void)
+{
+    _trmThreadExitKeyCreated = (pthread_key_create(&_trmThreadExitKey, _trmThreadExitCallback) == 0);
+}
+#endif
+
+static void _trmThreadExitKeySet(void* pValue);
+static void _trmThreadExitKeySet(void* pValue)
+{
+#ifdef _WIN32
+    InitOnceExecuteOnce(&_trmThreadExitOnce, _trmThreadExitKeyCreate, NULL, NULL);
+    if (_trmThreadExitKey != FLS_OUT_OF_INDEXES)
+        FlsSetValue(_trmThreadExitKey, pValue);
+#else
+    pthread_once(&_trmThreadExitOnce, _trmThreadExitKeyCreate);
+    if (_trmThreadExitKeyCreated == true)
+        pthread_setspecific(_trmThreadExitKey, pValue);
+#endif
+}
+
+struct TrmThreadContext_T* _trmThreadContextCreate(void)
+{
+    _trmThreadExitKeySet(&_trmThreadContextStorage);
+    _trmThreadContext = &_trmThreadContextStorage;
+
+    return _trmThreadContext;
+}
+
+void _trmThreadContextDestroy(void)
+{
+    struct TrmThreadContext_T* context = _trmThreadContext;
+
+    if (context == NULL)
+        return;
+
+    // the context stays set up until the end, as destructors may still use Termite. They may even get thread locals again, including ones that
+    // were destroyed already, so the slots are gone over until none is set. Thread locals still set after the last pass are freed without their destructor
+    bool isAnySet = true;
+    for (int iteration = 0; (iteration < TRM_THREAD_LOCAL_DESTRUCTOR_ITERATIONS) && (isAnySet == true); iteration++)
+    {
+        isAnySet = false;
+
+        uint64_t localCount = TRM_ATOMIC_LOAD64(&_trmThreadLocalCount);
+        for (uint64_t i = 0; i < localCount; i++)
+        {
+            void* pData = context->locals[i];
+
+            if (pData == NULL)
+                continue;
+
+            isAnySet = true;
+            context->locals[i] = NULL; // cleared before the destructor runs, so that getting the thread local again makes a new copy
+            if (_trmThreadLocals[i].pDestructor != NULL)
+                _trmThreadLocals[i].pDestructor(pData);
+            free(pData);
+        }
+    }
+
+    for (uint64_t i = 0; i < TRM_MAX_ITEM_COUNT; i++)
+    {
+        free(context->locals[i]);
+        context->locals[i] = NULL;
+    }
+
+    trmEpochThreadUnregister();
+
+    _trmThreadExitKeySet(NULL);
+    memset(context, 0, sizeof(struct TrmThreadContext_T));
+    _trmThreadContext = NULL;
+}
+
+// every thread created by Termite starts here, so its context is set up before the user's function runs and released after it
+#ifdef _WIN32
+static DWORD WINAPI _trmThreadStart(LPVOID pThread);
+static DWORD WINAPI _trmThreadStart(LPVOID pThread)
+#else
+static void* _trmThreadStart(void* pThread);
+static void* _trmThreadStart(void* pThread)
+#endif
+{
+    struct TrmThread_T* thread = pThread;
+
+    _trmThreadContextCreate();
+    _trmEpochThreadRegister();
+    thread->info.pProc(thread->info.pParam);
+    _trmThreadContextDestroy();
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
 
 TrmThread trmThreadCreate(struct TrmThreadInfo* info)
 {
@@ -11,19 +144,40 @@ TrmThread trmThreadCreate(struct TrmThreadInfo* info)
     thread->info = *info;
 
 #ifdef _WIN32
-    thread->hThread = CreateThread(NULL, info->stackSize, info->pProc, info->pParam, 0, NULL);
+    thread->hThread = CreateThread(NULL, info->stackSize, _trmThreadStart, thread, 0, NULL);
 
     if (thread->hThread == NULL)
     {
         thread->error = TRM_THREAD_COULDNT_CREATE_ERROR;
     }
 #else 
-    thread->id = pthread_create(&thread->hThread, NULL, info->pProc, info->pParam);
+    thread->id = pthread_create(&thread->hThread, NULL, _trmThreadStart, thread);
+
+    if (thread->id != 0)
+    {
+        thread->error = TRM_THREAD_COULDNT_CREATE_ERROR;
+    }
 #endif
 
     return (TrmThread)thread;
 }
 
+int trmThreadLocalRegister(struct TrmThreadLocalInfo* pInfo)
+{
+    int slot = TRM_GENERIC_OUT_OF_BOUNDS_ERROR;
+
+    TRM_MUTEX_LOCK(&_trmThreadLocalLock);
+    if (_trmThreadLocalCount < TRM_MAX_ITEM_COUNT)
+    {
+        slot = (int)_trmThreadLocalCount;
+        _trmThreadLocals[slot] = *pInfo;
+        TRM_ATOMIC_STORE64(&_trmThreadLocalCount, _trmThreadLocalCount + 1); // published after the info, so threads never see a slot without it
+    }
+    TRM_MUTEX_UNLOCK(&_trmThreadLocalLock);
+
+    return slot;
+}
+
 inline void trmThreadWait(TrmThread hThread)
 {
 #ifdef _WIN32
@@ -46,3 +200,27 @@ inline int trmThreadErrorGet(TrmThread hThread)
 {
     return TRM_HANDLE(Thread)->error;
 }
+
+TrmThreadContext trmThreadContextGet(void)
+{
+    return (TrmThreadContext)TRM_THREAD_CONTEXT;
+}
+
+void* trmThreadLocalGet(TrmThreadContext hThreadContext, int slot)
+{
+    struct TrmThreadContext_T* context = TRM_HANDLE(ThreadContext);
+
+    if (slot < 0 || slot >= TRM_MAX_ITEM_COUNT)
+        return NULL;
+
+    if (context->locals[slot] != NULL)
+        return context->locals[slot];
+
+    if ((uint64_t)slot >= TRM_ATOMIC_LOAD64(&_trmThreadLocalCount))
+        return NULL;
+
+    uint32_t size = _trmThreadLocals[slot].size;
+    context->locals[slot] = calloc(1, (size > 0) ? size : 1);
+
+    return context->locals[slot];
+}
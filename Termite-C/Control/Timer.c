@@ -0,0 +1,568 @@
+/*
+   Copyright 2023 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "../Internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <time.h>
+#endif
+
+/* -------------------- *
+ *       INTERNAL       *
+ * -------------------- */
+
+static uint64_t _trmMillisecondsGet(void);
+static uint64_t _trmMillisecondsGet(void)
+{
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+#endif
+}
+
+static void _trmConditionWaitFor(TrmCondition* pCondition, TrmMutex* pMutex, uint64_t milliseconds);
+static void _trmConditionWaitFor(TrmCondition* pCondition, TrmMutex* pMutex, uint64_t milliseconds)
+{
+    if (milliseconds > 24 * 60 * 60 * 1000) // the caller checks the time again when it wakes up, so there's no point in sleeping for longer than a day
+        milliseconds = 24 * 60 * 60 * 1000;
+
+#ifdef _WIN32
+    SleepConditionVariableSRW(pCondition, pMutex, (DWORD)milliseconds, 0);
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline); // the condition must be made with TRM_CONDITION_INIT_MONOTONIC, so that changes of the wall clock don't delay the wait
+    deadline.tv_sec += (time_t)(milliseconds / 1000);
+    deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_cond_timedwait(pCondition, pMutex, &deadline);
+#endif
+}
+
+static uint64_t _trmSchedulerTickGet(struct TrmScheduler_T* pScheduler);
+static uint64_t _trmSchedulerTickGet(struct TrmScheduler_T* pScheduler)
+{
+    return (_trmMillisecondsGet() - pScheduler->startTime) / pScheduler->info.resolution;
+}
+
+// puts a timer in the slot of the wheel its expiry belongs to. The expiry must not be before the current tick. O(1).
+static void _trmWheelInsert(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer);
+static void _trmWheelInsert(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer)
+{
+    uint64_t delta = pTimer->expiry - pScheduler->currentTick;
+
+    int level = 0;
+    while ((level < TRM_WHEEL_LEVEL_COUNT - 1) && (delta >= (1ull << (TRM_WHEEL_SLOT_BITS * (level + 1)))))
+        level++;
+
+    // timers further away than the wheel covers are put as far as possible. They will be put in the right slot when cascaded.
+    uint64_t target = pTimer->expiry;
+    if (delta >= (1ull << (TRM_WHEEL_SLOT_BITS * TRM_WHEEL_LEVEL_COUNT)))
+        target = pScheduler->currentTick + (1ull << (TRM_WHEEL_SLOT_BITS * TRM_WHEEL_LEVEL_COUNT)) - 1;
+
+    int slot = (int)((target >> (TRM_WHEEL_SLOT_BITS * level)) & (TRM_WHEEL_SLOT_COUNT - 1));
+
+    pTimer->level = level;
+    pTimer->slot = slot;
+    pTimer->previous = NULL;
+    pTimer->next = pScheduler->wheel[level][slot];
+    if (pTimer->next != NULL)
+        pTimer->next->previous = pTimer;
+    pScheduler->wheel[level][slot] = pTimer;
+
+    pScheduler->occupied[level] |= 1ull << slot;
+    pScheduler->timerCount++;
+}
+
+// O(1)
+static void _trmWheelRemove(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer);
+static void _trmWheelRemove(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer)
+{
+    if (pTimer->previous != NULL)
+        pTimer->previous->next = pTimer->next;
+    else
+        pScheduler->wheel[pTimer->level][pTimer->slot] = pTimer->next;
+    if (pTimer->next != NULL)
+        pTimer->next->previous = pTimer->previous;
+
+    if (pScheduler->wheel[pTimer->level][pTimer->slot] == NULL)
+        pScheduler->occupied[pTimer->level] &= ~(1ull << pTimer->slot);
+
+    pTimer->level = -1;
+    pScheduler->timerCount--;
+}
+
+// the next tick at which something happens in the wheel: either a timer expires or a slot of a higher level has to be cascaded.
+// Returns UINT64_MAX if the wheel is empty.
+static uint64_t _trmWheelNextTickGet(struct TrmScheduler_T* pScheduler);
+static uint64_t _trmWheelNextTickGet(struct TrmScheduler_T* pScheduler)
+{
+    uint64_t nextTick = UINT64_MAX;
+    if (pScheduler->timerCount == 0)
+        return nextTick;
+
+    for (int level = 0; level < TRM_WHEEL_LEVEL_COUNT; level++)
+    {
+        if (pScheduler->occupied[level] == 0)
+            continue;
+
+        uint64_t base = pScheduler->currentTick >> (TRM_WHEEL_SLOT_BITS * level);
+        for (uint64_t k = 1; k <= TRM_WHEEL_SLOT_COUNT; k++)
+        {
+            if ((pScheduler->occupied[level] & (1ull << ((base + k) & (TRM_WHEEL_SLOT_COUNT - 1)))) == 0)
+                continue;
+
+            uint64_t tick = (base + k) << (TRM_WHEEL_SLOT_BITS * level);
+            if (tick < nextTick)
+                nextTick = tick;
+            break;
+        }
+    }
+
+    return nextTick;
+}
+
+// moves the timers of the expiring slot to the dispatch queue, after moving the timers of higher levels that are now close enough to the lower levels
+static void _trmWheelTick(struct TrmScheduler_T* pScheduler);
+static void _trmWheelTick(struct TrmScheduler_T* pScheduler)
+{
+    uint64_t tick = pScheduler->currentTick;
+
+    int topLevel = 0;
+    while ((topLevel < TRM_WHEEL_LEVEL_COUNT - 1) && ((tick & ((1ull << (TRM_WHEEL_SLOT_BITS * (topLevel + 1))) - 1)) == 0))
+        topLevel++;
+
+    for (int level = topLevel; level > 0; level--)
+    {
+        int slot = (int)((tick >> (TRM_WHEEL_SLOT_BITS * level)) & (TRM_WHEEL_SLOT_COUNT - 1));
+
+        struct TrmTimer_T* timer = pScheduler->wheel[level][slot];
+        pScheduler->wheel[level][slot] = NULL;
+        pScheduler->occupied[level] &= ~(1ull << slot);
+
+        while (timer != NULL)
+        {
+            struct TrmTimer_T* next = timer->next;
+            pScheduler->timerCount--;
+            _trmWheelInsert(pScheduler, timer);
+            timer = next;
+        }
+    }
+
+    int slot = (int)(tick & (TRM_WHEEL_SLOT_COUNT - 1));
+
+    struct TrmTimer_T* timer = pScheduler->wheel[0][slot];
+    pScheduler->wheel[0][slot] = NULL;
+    pScheduler->occupied[0] &= ~(1ull << slot);
+
+    while (timer != NULL)
+    {
+        struct TrmTimer_T* next = timer->next;
+        pScheduler->timerCount--;
+
+        timer->level = -1;
+        timer->isQueued = true;
+        timer->next = NULL;
+        if (pScheduler->queueTail != NULL)
+            pScheduler->queueTail->next = timer;
+        else
+            pScheduler->queueHead = timer;
+        pScheduler->queueTail = timer;
+
+        timer = next;
+    }
+}
+
+// puts a timer in the wheel for the first time, or again if it's periodic. The deadline is rounded up to the coalescing window, but only for the expiry,
+// so the rounding never adds up over the periods.
+static void _trmTimerSchedule(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer);
+static void _trmTimerSchedule(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer)
+{
+    uint64_t expiry = pTimer->deadline;
+    if (expiry <= pScheduler->currentTick)
+        expiry = pScheduler->currentTick + 1;
+
+    pTimer->expiry = ((expiry + pScheduler->windowTicks - 1) / pScheduler->windowTicks) * pScheduler->windowTicks;
+
+    _trmWheelInsert(pScheduler, pTimer);
+
+    if (pTimer->expiry < pScheduler->nextWakeTick)
+        TRM_CONDITION_SIGNAL(&pScheduler->timerCondition);
+}
+
+// takes a free timer, adding a page of them if there is none. Must be called with the lock held. Returns NULL and reports the error if it can't
+static struct TrmTimer_T* _trmTimerTake(struct TrmScheduler_T* pScheduler);
+static struct TrmTimer_T* _trmTimerTake(struct TrmScheduler_T* pScheduler)
+{
+    if (pScheduler->freeTimers == NULL)
+    {
+        if ((uint64_t)(pScheduler->timerPageCount + 1) * TRM_TIMER_PAGE_SIZE >= (1ull << TRM_TIMER_INDEX_BITS))
+        {
+            pScheduler->error = TRM_GENERIC_OUT_OF_BOUNDS_ERROR;
+            return NULL;
+        }
+
+        struct TrmTimer_T** pages = realloc(pScheduler->timerPages, (pScheduler->timerPageCount + 1) * sizeof(struct TrmTimer_T*));
+        if (pages == NULL)
+        {
+            pScheduler->error = TRM_GENERIC_OOM_ERROR;
+            return NULL;
+        }
+        pScheduler->timerPages = pages;
+
+        struct TrmTimer_T* page = calloc(TRM_TIMER_PAGE_SIZE, sizeof(struct TrmTimer_T));
+        if (page == NULL)
+        {
+            pScheduler->error = TRM_GENERIC_OOM_ERROR;
+            return NULL;
+        }
+        pScheduler->timerPages[pScheduler->timerPageCount] = page;
+
+        for (int i = TRM_TIMER_PAGE_SIZE - 1; i >= 0; i--)
+        {
+            page[i].index = pScheduler->timerPageCount * TRM_TIMER_PAGE_SIZE + i;
+            page[i].next = pScheduler->freeTimers;
+            pScheduler->freeTimers = &page[i];
+        }
+        pScheduler->timerPageCount++;
+    }
+
+    struct TrmTimer_T* timer = pScheduler->freeTimers;
+    pScheduler->freeTimers = timer->next;
+
+    uint32_t index = timer->index;
+    uintptr_t generation = timer->generation;
+    memset(timer, 0, sizeof(struct TrmTimer_T));
+    timer->index = index;
+    timer->generation = generation;
+    timer->isUsed = true;
+
+    return timer;
+}
+
+// gives a timer back to the free timers. Its handles stop matching it. Must be called with the lock held
+static void _trmTimerRelease(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer);
+static void _trmTimerRelease(struct TrmScheduler_T* pScheduler, struct TrmTimer_T* pTimer)
+{
+    pTimer->isUsed = false;
+    pTimer->generation = (pTimer->generation + 1) & (UINTPTR_MAX >> TRM_TIMER_INDEX_BITS);
+    pTimer->next = pScheduler->freeTimers;
+    pScheduler->freeTimers = pTimer;
+}
+
+static TrmTimer _trmTimerHandleGet(struct TrmTimer_T* pTimer);
+static TrmTimer _trmTimerHandleGet(struct TrmTimer_T* pTimer)
+{
+    return (TrmTimer)((pTimer->generation << TRM_TIMER_INDEX_BITS) | ((uintptr_t)pTimer->index + 1));
+}
+
+// returns the timer of a handle, or NULL if the timer was released since the handle was made. Must be called with the lock held
+static struct TrmTimer_T* _trmTimerHandleResolve(struct TrmScheduler_T* pScheduler, TrmTimer hTimer);
+static struct TrmTimer_T* _trmTimerHandleResolve(struct TrmScheduler_T* pScheduler, TrmTimer hTimer)
+{
+    uintptr_t value = (uintptr_t)hTimer;
+    uintptr_t index = value & ((1ull << TRM_TIMER_INDEX_BITS) - 1);
+
+    if ((index == 0) || (index - 1 >= (uintptr_t)pScheduler->timerPageCount * TRM_TIMER_PAGE_SIZE))
+        return NULL;
+
+    struct TrmTimer_T* timer = &pScheduler->timerPages[(index - 1) / TRM_TIMER_PAGE_SIZE][(index - 1) % TRM_TIMER_PAGE_SIZE];
+    if ((timer->isUsed == false) || (timer->generation != (value >> TRM_TIMER_INDEX_BITS)))
+        return NULL;
+
+    return timer;
+}
+
+// runs the first timer of the dispatch queue. Must be called with the lock held, which is released while the callback runs.
+static void _trmSchedulerQueueRun(struct TrmScheduler_T* pScheduler);
+static void _trmSchedulerQueueRun(struct TrmScheduler_T* pScheduler)
+{
+    struct TrmTimer_T* timer = pScheduler->queueHead;
+    pScheduler->queueHead = timer->next;
+    if (pScheduler->queueHead == NULL)
+        pScheduler->queueTail = NULL;
+    timer->isQueued = false;
+
+    if (timer->isCancelled == false)
+    {
+        struct TrmThreadContext_T* context = TRM_THREAD_CONTEXT;
+
+        timer->isRunning = true;
+        TRM_MUTEX_UNLOCK(&pScheduler->lock);
+
+        struct TrmScheduler_T* previous = context->runningScheduler;
+        context->runningScheduler = pScheduler; // so that trmSchedulerDestroy can tell it's called from a callback
+        timer->info.pProc(timer->info.pParam);
+        context->runningScheduler = previous;
+
+        TRM_MUTEX_LOCK(&pScheduler->lock);
+        timer->isRunning = false;
+    }
+
+    // timers that fire once release themselves, so nobody has to cancel them after they have fired
+    if ((timer->isCancelled == true) || (timer->period == 0))
+        _trmTimerRelease(pScheduler, timer);
+    else if (pScheduler->isStopping == false)
+    {
+        timer->deadline += timer->period; // counting from the previous deadline, so that periodic timers don't drift
+        if (timer->deadline <= pScheduler->currentTick) // the callback took longer than the period. The missed firings are skipped, without losing the phase
+            timer->deadline += ((pScheduler->currentTick - timer->deadline) / timer->period + 1) * timer->period;
+        _trmTimerSchedule(pScheduler, timer);
+    }
+}
+
+static void _trmSchedulerTimerRun(void* pParam);
+static void _trmSchedulerTimerRun(void* pParam)
+{
+    struct TrmScheduler_T* scheduler = (struct TrmScheduler_T*)pParam;
+
+    TRM_MUTEX_LOCK(&scheduler->lock);
+    while (scheduler->isStopping == false)
+    {
+        // jump straight to the ticks where something happens, instead of going through every tick
+        uint64_t now = _trmSchedulerTickGet(scheduler);
+        uint64_t nextTick = _trmWheelNextTickGet(scheduler);
+        while (nextTick <= now)
+        {
+            scheduler->currentTick = nextTick;
+            _trmWheelTick(scheduler);
+            nextTick = _trmWheelNextTickGet(scheduler);
+        }
+        if (now > scheduler->currentTick)
+            scheduler->currentTick = now;
+
+        if (scheduler->queueHead != NULL)
+        {
+            if (scheduler->info.workerCount == 0)
+            {
+                while ((scheduler->queueHead != NULL) && (scheduler->isStopping == false))
+                    _trmSchedulerQueueRun(scheduler);
+                continue; // the callbacks may have taken a while
+            }
+
+            TRM_CONDITION_BROADCAST(&scheduler->workCondition);
+        }
+
+        scheduler->nextWakeTick = nextTick;
+        if (nextTick == UINT64_MAX)
+            TRM_CONDITION_WAIT(&scheduler->timerCondition, &scheduler->lock);
+        else
+            _trmConditionWaitFor(&scheduler->timerCondition, &scheduler->lock, (nextTick - now) * scheduler->info.resolution);
+        scheduler->nextWakeTick = 0; // while the timer thread is awake, there's no need to wake it up
+    }
+    TRM_MUTEX_UNLOCK(&scheduler->lock);
+}
+
+static void _trmSchedulerWorkerRun(void* pParam);
+static void _trmSchedulerWorkerRun(void* pParam)
+{
+    struct TrmScheduler_T* scheduler = (struct TrmScheduler_T*)pParam;
+
+    TRM_MUTEX_LOCK(&scheduler->lock);
+    while (true)
+    {
+        while ((scheduler->queueHead == NULL) && (scheduler->isStopping == false))
+            TRM_CONDITION_WAIT(&scheduler->workCondition, &scheduler->lock);
+
+        if (scheduler->isStopping == true)
+            break;
+
+        _trmSchedulerQueueRun(scheduler);
+    }
+    TRM_MUTEX_UNLOCK(&scheduler->lock);
+}
+
+static TrmTimer _trmTimerCreate(struct TrmTimerInfo* pInfo, uint64_t period, struct TrmScheduler_T* pScheduler);
+static TrmTimer _trmTimerCreate(struct TrmTimerInfo* pInfo, uint64_t period, struct TrmScheduler_T* pScheduler)
+{
+    uint64_t now = _trmSchedulerTickGet(pScheduler);
+
+    TRM_MUTEX_LOCK(&pScheduler->lock);
+
+    struct TrmTimer_T* timer = _trmTimerTake(pScheduler);
+    if (timer == NULL)
+    {
+        TRM_MUTEX_UNLOCK(&pScheduler->lock);
+        return NULL;
+    }
+
+    timer->info = *pInfo;
+    timer->period = (period + pScheduler->info.resolution - 1) / pScheduler->info.resolution; // transform from milliseconds to ticks
+    if ((period > 0) && (timer->period == 0))
+        timer->period = 1;
+
+    timer->deadline = now + (pInfo->delay + pScheduler->info.resolution - 1) / pScheduler->info.resolution;
+    _trmTimerSchedule(pScheduler, timer);
+
+    TrmTimer hTimer = _trmTimerHandleGet(timer); // made before the lock is released, as the timer may fire and be released right after
+
+    TRM_MUTEX_UNLOCK(&pScheduler->lock);
+
+    return hTimer;
+}
+
+/* -------------------- *
+ *   INITIALIZE         *
+ * -------------------- */
+
+TrmScheduler trmSchedulerCreate(struct TrmSchedulerInfo* pInfo)
+{
+    struct TrmScheduler_T* scheduler = calloc(1, sizeof(struct TrmScheduler_T));
+
+    if (scheduler == NULL)
+        return NULL;
+
+    scheduler->info = *pInfo;
+    if (scheduler->info.resolution == 0)
+        scheduler->info.resolution = 1;
+    if (scheduler->info.workerCount > TRM_MAX_ITEM_COUNT)
+        scheduler->info.workerCount = TRM_MAX_ITEM_COUNT;
+
+    scheduler->windowTicks = scheduler->info.coalescingWindow / scheduler->info.resolution;
+    if (scheduler->windowTicks == 0)
+        scheduler->windowTicks = 1;
+
+    scheduler->startTime = _trmMillisecondsGet();
+    scheduler->error = TRM_SUCCESS;
+
+    TRM_MUTEX_INIT(&scheduler->lock);
+    TRM_CONDITION_INIT_MONOTONIC(&scheduler->timerCondition);
+    TRM_CONDITION_INIT(&scheduler->workCondition);
+
+    struct TrmThreadInfo threadInfo = {
+        .paramSize = sizeof(struct TrmScheduler_T),
+        .pParam = scheduler,
+        .stackSize = pInfo->stackSize,
+        .pProc = &_trmSchedulerTimerRun,
+    };
+    scheduler->hTimerThread = trmThreadCreate(&threadInfo);
+    if ((scheduler->hTimerThread == NULL) || (trmThreadErrorGet(scheduler->hTimerThread) < 0))
+        scheduler->error = TRM_THREAD_COULDNT_CREATE_ERROR;
+
+    threadInfo.pProc = &_trmSchedulerWorkerRun;
+    for (uint32_t i = 0; i < scheduler->info.workerCount; i++)
+    {
+        scheduler->hWorkers[i] = trmThreadCreate(&threadInfo);
+        if ((scheduler->hWorkers[i] == NULL) || (trmThreadErrorGet(scheduler->hWorkers[i]) < 0))
+            scheduler->error = TRM_THREAD_COULDNT_CREATE_ERROR;
+    }
+
+    return (TrmScheduler)scheduler;
+}
+
+/* -------------------- *
+ *   CHANGE             *
+ * -------------------- */
+
+TrmTimer trmScheduleAfter(struct TrmTimerInfo* pInfo, TrmScheduler hScheduler)
+{
+    return _trmTimerCreate(pInfo, 0, TRM_SCHEDULER);
+}
+
+TrmTimer trmScheduleEvery(struct TrmTimerInfo* pInfo, TrmScheduler hScheduler)
+{
+    return _trmTimerCreate(pInfo, (pInfo->period == 0) ? 1 : pInfo->period, TRM_SCHEDULER);
+}
+
+void trmTimerCancel(TrmTimer hTimer, TrmScheduler hScheduler)
+{
+    if (hTimer == NULL)
+        return;
+
+    struct TrmScheduler_T* scheduler = TRM_SCHEDULER;
+
+    TRM_MUTEX_LOCK(&scheduler->lock);
+
+    struct TrmTimer_T* timer = _trmTimerHandleResolve(scheduler, hTimer);
+    if ((timer == NULL) || (timer->isCancelled == true))
+    {
+        TRM_MUTEX_UNLOCK(&scheduler->lock);
+        return;
+    }
+
+    timer->isCancelled = true;
+    if (timer->level >= 0)
+        _trmWheelRemove(scheduler, timer);
+
+    // a queued or running timer is released by the thread that runs it
+    if ((timer->isQueued == false) && (timer->isRunning == false))
+        _trmTimerRelease(scheduler, timer);
+
+    TRM_MUTEX_UNLOCK(&scheduler->lock);
+}
+
+/* -------------------- *
+ *   GET & SET          *
+ * -------------------- */
+
+inline int trmSchedulerErrorGet(TrmScheduler hScheduler)
+{
+    TRM_MUTEX_LOCK(&TRM_SCHEDULER->lock);
+    int error = TRM_SCHEDULER->error;
+    TRM_MUTEX_UNLOCK(&TRM_SCHEDULER->lock);
+
+    return error;
+}
+
+/* -------------------- *
+ *   DESTROY            *
+ * -------------------- */
+
+void trmSchedulerDestroy(TrmScheduler hScheduler)
+{
+    struct TrmScheduler_T* scheduler = TRM_SCHEDULER;
+
+    TRM_MUTEX_LOCK(&scheduler->lock);
+    if (TRM_THREAD_CONTEXT->runningScheduler == scheduler) // the thread would wait for itself to finish
+    {
+        scheduler->error = TRM_THREAD_DEADLOCK_ERROR;
+        TRM_MUTEX_UNLOCK(&scheduler->lock);
+        return;
+    }
+    scheduler->isStopping = true;
+    TRM_CONDITION_BROADCAST(&scheduler->timerCondition);
+    TRM_CONDITION_BROADCAST(&scheduler->workCondition);
+    TRM_MUTEX_UNLOCK(&scheduler->lock);
+
+    if ((scheduler->hTimerThread != NULL) && (trmThreadErrorGet(scheduler->hTimerThread) == TRM_SUCCESS))
+        trmThreadWait(scheduler->hTimerThread);
+    free(scheduler->hTimerThread);
+
+    for (uint32_t i = 0; i < scheduler->info.workerCount; i++)
+    {
+        if ((scheduler->hWorkers[i] != NULL) && (trmThreadErrorGet(scheduler->hWorkers[i]) == TRM_SUCCESS))
+            trmThreadWait(scheduler->hWorkers[i]);
+        free(scheduler->hWorkers[i]);
+    }
+
+    for (uint32_t i = 0; i < scheduler->timerPageCount; i++)
+        free(scheduler->timerPages[i]);
+    free(scheduler->timerPages);
+
+    TRM_CONDITION_DESTROY(&scheduler->workCondition);
+    TRM_CONDITION_DESTROY(&scheduler->timerCondition);
+    TRM_MUTEX_DESTROY(&scheduler->lock);
+    free(scheduler);
+}
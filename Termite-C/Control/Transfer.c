@@ -0,0 +1,757 @@
+/*
+   Copyright 2023 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "../Internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define TRM_TRANSFER_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define TRM_TARGET(features) // MSVC lets any intrinsic be used without enabling it first
+    #else
+        #define TRM_TARGET(features) __attribute__((target(features)))
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define TRM_TRANSFER_NEON // NEON is part of the base of AArch64, so there is nothing to check at runtime
+    #include <arm_neon.h>
+#endif
+
+#define TRM_TRANSFER_NON_TEMPORAL_THRESHOLD (1 << 20) // copies and fills bigger than this (in bytes) bypass the cache, as they wouldn't fit in it anyway
+#define TRM_TRANSFER_MIN_THREAD_SIZE        (1 << 20) // the smallest amount of bytes worth giving to a thread of its own
+
+#define TRM_TRANSFER_FILL           0
+#define TRM_TRANSFER_COPY           1
+#define TRM_TRANSFER_COPY_FROM_HOST 2
+#define TRM_TRANSFER_COPY_TO_HOST   3
+#define TRM_TRANSFER_COMPARE        4
+
+/* -------------------- *
+ *       KERNELS        *
+ * -------------------- */
+
+// every kernel works on a single contiguous range. `size` is in bytes.
+struct TrmTransferKernels
+{
+    void (*pCopy)(uint8_t* pDst, const uint8_t* pSrc, uint64_t size, bool nonTemporal);
+    void (*pFill)(uint8_t* pDst, uint32_t value, uint64_t size, bool nonTemporal);
+    int  (*pCompare)(const uint8_t* pA, const uint8_t* pB, uint64_t size);
+};
+
+static void _trmCopyScalar(uint8_t* pDst, const uint8_t* pSrc, uint64_t size, bool nonTemporal)
+{
+    (void)nonTemporal;
+
+    memcpy(pDst, pSrc, size);
+}
+
+// ranges always start at a multiple of 4 bytes, so the value is never out of phase
+static void _trmFillScalar(uint8_t* pDst, uint32_t value, uint64_t size, bool nonTemporal)
+{
+    (void)nonTemporal;
+
+    uint64_t i = 0;
+    for (; i + 4 <= size; i += 4)
+        memcpy(pDst + i, &value, 4);
+    memcpy(pDst + i, &value, size - i);
+}
+
+static int _trmCompareScalar(const uint8_t* pA, const uint8_t* pB, uint64_t size)
+{
+    return memcmp(pA, pB, size);
+}
+
+static const struct TrmTransferKernels _trmKernelsScalar = { _trmCopyScalar, _trmFillScalar, _trmCompareScalar };
+
+#ifdef TRM_TRANSFER_X86
+TRM_TARGET("avx2") static void _trmCopyAvx2(uint8_t* pDst, const uint8_t* pSrc, uint64_t size, bool nonTemporal)
+{
+    uint64_t i = 0;
+    if (nonTemporal == true)
+    {
+        // streaming stores need an aligned destination
+        i = (32 - ((uintptr_t)pDst & 31)) & 31;
+        if (i > size)
+            i = size;
+        memcpy(pDst, pSrc, i);
+
+        for (; i + 128 <= size; i += 128)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(pSrc + i + 32));
+            __m256i c = _mm256_loadu_si256((const __m256i*)(pSrc + i + 64));
+            __m256i d = _mm256_loadu_si256((const __m256i*)(pSrc + i + 96));
+            _mm256_stream_si256((__m256i*)(pDst + i), a);
+            _mm256_stream_si256((__m256i*)(pDst + i + 32), b);
+            _mm256_stream_si256((__m256i*)(pDst + i + 64), c);
+            _mm256_stream_si256((__m256i*)(pDst + i + 96), d);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 128 <= size; i += 128)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(pSrc + i + 32));
+            __m256i c = _mm256_loadu_si256((const __m256i*)(pSrc + i + 64));
+            __m256i d = _mm256_loadu_si256((const __m256i*)(pSrc + i + 96));
+            _mm256_storeu_si256((__m256i*)(pDst + i), a);
+            _mm256_storeu_si256((__m256i*)(pDst + i + 32), b);
+            _mm256_storeu_si256((__m256i*)(pDst + i + 64), c);
+            _mm256_storeu_si256((__m256i*)(pDst + i + 96), d);
+        }
+    }
+
+    for (; i + 32 <= size; i += 32)
+        _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_loadu_si256((const __m256i*)(pSrc + i)));
+    memcpy(pDst + i, pSrc + i, size - i);
+}
+
+TRM_TARGET("avx2") static void _trmFillAvx2(uint8_t* pDst, uint32_t value, uint64_t size, bool nonTemporal)
+{
+    __m256i pattern = _mm256_set1_epi32((int)value);
+
+    uint64_t i = 0;
+    if (nonTemporal == true)
+    {
+        // the head is a multiple of 4 bytes, as both the destination and the block are, so the pattern stays in phase
+        i = (32 - ((uintptr_t)pDst & 31)) & 31;
+        if (i > size)
+            i = size;
+        _trmFillScalar(pDst, value, i, false);
+
+        for (; i + 32 <= size; i += 32)
+            _mm256_stream_si256((__m256i*)(pDst + i), pattern);
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 32 <= size; i += 32)
+            _mm256_storeu_si256((__m256i*)(pDst + i), pattern);
+    }
+
+    _trmFillScalar(pDst + i, value, size - i, false);
+}
+
+TRM_TARGET("avx2") static int _trmCompareAvx2(const uint8_t* pA, const uint8_t* pB, uint64_t size)
+{
+    uint64_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(pA + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(pB + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) != -1)
+            return memcmp(pA + i, pB + i, 32); // memcmp gives us the sign of the first difference
+    }
+
+    return memcmp(pA + i, pB + i, size - i);
+}
+
+static const struct TrmTransferKernels _trmKernelsAvx2 = { _trmCopyAvx2, _trmFillAvx2, _trmCompareAvx2 };
+
+TRM_TARGET("avx512f") static void _trmCopyAvx512(uint8_t* pDst, const uint8_t* pSrc, uint64_t size, bool nonTemporal)
+{
+    uint64_t i = 0;
+    if (nonTemporal == true)
+    {
+        i = (64 - ((uintptr_t)pDst & 63)) & 63;
+        if (i > size)
+            i = size;
+        memcpy(pDst, pSrc, i);
+
+        for (; i + 256 <= size; i += 256)
+        {
+            __m512i a = _mm512_loadu_si512((const void*)(pSrc + i));
+            __m512i b = _mm512_loadu_si512((const void*)(pSrc + i + 64));
+            __m512i c = _mm512_loadu_si512((const void*)(pSrc + i + 128));
+            __m512i d = _mm512_loadu_si512((const void*)(pSrc + i + 192));
+            _mm512_stream_si512((void*)(pDst + i), a);
+            _mm512_stream_si512((void*)(pDst + i + 64), b);
+            _mm512_stream_si512((void*)(pDst + i + 128), c);
+            _mm512_stream_si512((void*)(pDst + i + 192), d);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 256 <= size; i += 256)
+        {
+            __m512i a = _mm512_loadu_si512((const void*)(pSrc + i));
+            __m512i b = _mm512_loadu_si512((const void*)(pSrc + i + 64));
+            __m512i c = _mm512_loadu_si512((const void*)(pSrc + i + 128));
+            __m512i d = _mm512_loadu_si512((const void*)(pSrc + i + 192));
+            _mm512_storeu_si512((void*)(pDst + i), a);
+            _mm512_storeu_si512((void*)(pDst + i + 64), b);
+            _mm512_storeu_si512((void*)(pDst + i + 128), c);
+            _mm512_storeu_si512((void*)(pDst + i + 192), d);
+        }
+    }
+
+    for (; i + 64 <= size; i += 64)
+        _mm512_storeu_si512((void*)(pDst + i), _mm512_loadu_si512((const void*)(pSrc + i)));
+    memcpy(pDst + i, pSrc + i, size - i);
+}
+
+TRM_TARGET("avx512f") static void _trmFillAvx512(uint8_t* pDst, uint32_t value, uint64_t size, bool nonTemporal)
+{
+    __m512i pattern = _mm512_set1_epi32((int)value);
+
+    uint64_t i = 0;
+    if (nonTemporal == true)
+    {
+        i = (64 - ((uintptr_t)pDst & 63)) & 63;
+        if (i > size)
+            i = size;
+        _trmFillScalar(pDst, value, i, false);
+
+        for (; i + 64 <= size; i += 64)
+            _mm512_stream_si512((void*)(pDst + i), pattern);
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 64 <= size; i += 64)
+            _mm512_storeu_si512((void*)(pDst + i), pattern);
+    }
+
+    _trmFillScalar(pDst + i, value, size - i, false);
+}
+
+TRM_TARGET("avx512f") static int _trmCompareAvx512(const uint8_t* pA, const uint8_t* pB, uint64_t size)
+{
+    uint64_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m512i a = _mm512_loadu_si512((const void*)(pA + i));
+        __m512i b = _mm512_loadu_si512((const void*)(pB + i));
+        if (_mm512_cmpneq_epi32_mask(a, b) != 0)
+            return memcmp(pA + i, pB + i, 64);
+    }
+
+    return memcmp(pA + i, pB + i, size - i);
+}
+
+static const struct TrmTransferKernels _trmKernelsAvx512 = { _trmCopyAvx512, _trmFillAvx512, _trmCompareAvx512 };
+#endif
+
+#ifdef TRM_TRANSFER_NEON
+// NEON has no streaming stores, so `nonTemporal` is ignored
+static void _trmCopyNeon(uint8_t* pDst, const uint8_t* pSrc, uint64_t size, bool nonTemporal)
+{
+    (void)nonTemporal;
+
+    uint64_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        uint8x16_t a = vld1q_u8(pSrc + i);
+        uint8x16_t b = vld1q_u8(pSrc + i + 16);
+        uint8x16_t c = vld1q_u8(pSrc + i + 32);
+        uint8x16_t d = vld1q_u8(pSrc + i + 48);
+        vst1q_u8(pDst + i, a);
+        vst1q_u8(pDst + i + 16, b);
+        vst1q_u8(pDst + i + 32, c);
+        vst1q_u8(pDst + i + 48, d);
+    }
+
+    for (; i + 16 <= size; i += 16)
+        vst1q_u8(pDst + i, vld1q_u8(pSrc + i));
+    memcpy(pDst + i, pSrc + i, size - i);
+}
+
+static void _trmFillNeon(uint8_t* pDst, uint32_t value, uint64_t size, bool nonTemporal)
+{
+    (void)nonTemporal;
+
+    uint8x16_t pattern = vreinterpretq_u8_u32(vdupq_n_u32(value));
+
+    uint64_t i = 0;
+    for (; i + 16 <= size; i += 16)
+        vst1q_u8(pDst + i, pattern);
+
+    _trmFillScalar(pDst + i, value, size - i, false);
+}
+
+static int _trmCompareNeon(const uint8_t* pA, const uint8_t* pB, uint64_t size)
+{
+    uint64_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        if (vminvq_u8(vceqq_u8(vld1q_u8(pA + i), vld1q_u8(pB + i))) != 0xFF)
+            return memcmp(pA + i, pB + i, 16);
+    }
+
+    return memcmp(pA + i, pB + i, size - i);
+}
+
+static const struct TrmTransferKernels _trmKernelsNeon = { _trmCopyNeon, _trmFillNeon, _trmCompareNeon };
+#endif
+
+static const struct TrmTransferKernels* _trmTransferKernelsGet(void);
+static const struct TrmTransferKernels* _trmTransferKernelsGet(void)
+{
+    // every thread that gets here first will pick the same kernels, so it doesn't matter who publishes them, as long as it's done atomically
+    static const struct TrmTransferKernels* pPublishedKernels = NULL;
+    const struct TrmTransferKernels* pKernels = TRM_ATOMIC_LOAD_PTR(&pPublishedKernels);
+    if (pKernels != NULL)
+        return pKernels;
+
+    pKernels = &_trmKernelsScalar;
+
+#if defined(TRM_TRANSFER_X86) && defined(_MSC_VER)
+    int registers[4];
+    __cpuid(registers, 1);
+    if ((registers[2] & (1 << 27)) != 0) // the OS saves the extended registers (OSXSAVE)
+    {
+        uint64_t enabledState = _xgetbv(0);
+        __cpuidex(registers, 7, 0);
+
+        if (((registers[1] & (1 << 16)) != 0) && ((enabledState & 0xE6) == 0xE6))
+            pKernels = &_trmKernelsAvx512;
+        else if (((registers[1] & (1 << 5)) != 0) && ((enabledState & 0x6) == 0x6))
+            pKernels = &_trmKernelsAvx2;
+    }
+#elif defined(TRM_TRANSFER_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        pKernels = &_trmKernelsAvx512;
+    else if (__builtin_cpu_supports("avx2"))
+        pKernels = &_trmKernelsAvx2;
+#elif defined(TRM_TRANSFER_NEON)
+    pKernels = &_trmKernelsNeon;
+#endif
+
+    TRM_ATOMIC_STORE_PTR(&pPublishedKernels, pKernels);
+
+    return pKernels;
+}
+
+/* -------------------- *
+ *       INTERNAL       *
+ * -------------------- */
+
+// walks the chunks of a buffer (or a piece of host memory, if pBuffer is NULL) as if it was contiguous memory
+struct TrmBufferCursor
+{
+    struct TrmBuffer_T* pBuffer;
+    uint8_t*            pHost;
+
+    int      chunk;
+    uint64_t chunkOffset;
+};
+
+static void _trmBufferCursorInit(struct TrmBufferCursor* pCursor, struct TrmBuffer_T* pBuffer, uint8_t* pHost, uint64_t offset);
+static void _trmBufferCursorInit(struct TrmBufferCursor* pCursor, struct TrmBuffer_T* pBuffer, uint8_t* pHost, uint64_t offset)
+{
+    pCursor->pBuffer = pBuffer;
+    pCursor->pHost = pHost;
+    pCursor->chunk = 0;
+    pCursor->chunkOffset = offset;
+
+    if (pBuffer == NULL)
+        return;
+
+    while ((pCursor->chunk < TRM_MAX_ITEM_COUNT) && (pCursor->chunkOffset >= pBuffer->chunks[pCursor->chunk].size) && (pBuffer->chunks[pCursor->chunk].associatedBlock != NULL))
+    {
+        pCursor->chunkOffset -= pBuffer->chunks[pCursor->chunk].size;
+        pCursor->chunk++;
+    }
+}
+
+// returns the address the cursor points to and how many bytes after it are contiguous
+static uint8_t* _trmBufferCursorSpan(struct TrmBufferCursor* pCursor, uint64_t* pSize);
+static uint8_t* _trmBufferCursorSpan(struct TrmBufferCursor* pCursor, uint64_t* pSize)
+{
+    if (pCursor->pBuffer == NULL)
+    {
+        *pSize = UINT64_MAX;
+        return pCursor->pHost + pCursor->chunkOffset;
+    }
+
+    struct TrmBufferChunk_T* chunk = &pCursor->pBuffer->chunks[pCursor->chunk];
+    *pSize = chunk->size - pCursor->chunkOffset;
+    return (uint8_t*)chunk->associatedBlock->startingAddress + chunk->offset + pCursor->chunkOffset;
+}
+
+static void _trmBufferCursorAdvance(struct TrmBufferCursor* pCursor, uint64_t size);
+static void _trmBufferCursorAdvance(struct TrmBufferCursor* pCursor, uint64_t size)
+{
+    pCursor->chunkOffset += size;
+
+    if ((pCursor->pBuffer != NULL) && (pCursor->chunkOffset == pCursor->pBuffer->chunks[pCursor->chunk].size))
+    {
+        pCursor->chunk++;
+        pCursor->chunkOffset = 0;
+    }
+}
+
+// checks that [offset, offset + size) is inside the buffer and that all of its chunks are reachable by the host
+static int _trmBufferRangeCheck(struct TrmBuffer_T* pBuffer, uint64_t offset, uint64_t size);
+static int _trmBufferRangeCheck(struct TrmBuffer_T* pBuffer, uint64_t offset, uint64_t size)
+{
+    if ((offset > pBuffer->size) || (size > pBuffer->size - offset))
+        return TRM_MEMORY_OUT_OF_BOUNDS_ERROR;
+
+    uint64_t chunkStart = 0;
+    for (int i = 0; (i < TRM_MAX_ITEM_COUNT) && (chunkStart < offset + size); i++)
+    {
+        struct TrmBufferChunk_T* chunk = &pBuffer->chunks[i];
+        if (chunk->associatedBlock == NULL)
+            break;
+
+        if ((chunkStart + chunk->size > offset) && (chunk->associatedBlock->startingAddress == NULL))
+            return TRM_MEMORY_UNMAPPED_ERROR;
+
+        chunkStart += chunk->size;
+    }
+
+    return TRM_SUCCESS;
+}
+
+struct TrmTransferJob
+{
+    int operation; // TRM_TRANSFER_*
+
+    struct TrmBuffer_T* pDst;
+    uint8_t*            pDstHost;
+    uint64_t            dstOffset; // in BYTES
+
+    struct TrmBuffer_T* pSrc;
+    uint8_t*            pSrcHost;
+    uint64_t            srcOffset; // in BYTES
+
+    uint64_t size; // in BYTES
+    uint32_t value;
+    bool     nonTemporal;
+
+    int result; // the result of the comparison, if the job is one
+
+    uint32_t*              pPending; // how many parts of the split job the job is a part of aren't done yet
+    struct TrmTransferJob* next; // the next part in the queue of the workers
+};
+
+// the parts of split jobs are run by workers, which are created the first time they are needed and kept until the process ends.
+// That way, splitting a job doesn't create and destroy threads (and set up their contexts) every time.
+static TrmMutex               _trmTransferLock = TRM_MUTEX_INITIALIZER; // guards everything below, as well as the `pPending` counters of the jobs
+static TrmCondition           _trmTransferQueued = TRM_CONDITION_INITIALIZER; // signaled when parts are queued
+static TrmCondition           _trmTransferDone = TRM_CONDITION_INITIALIZER; // broadcast when the last part of a split job is done
+static struct TrmTransferJob* _trmTransferQueueHead = NULL;
+static struct TrmTransferJob* _trmTransferQueueTail = NULL;
+static TrmThread              _trmTransferWorkers[TRM_MAX_ITEM_COUNT];
+static uint32_t               _trmTransferWorkerCount = 0;
+
+static void _trmTransferJobRun(void* pParam);
+static void _trmTransferJobRun(void* pParam)
+{
+    struct TrmTransferJob* job = (struct TrmTransferJob*)pParam;
+    const struct TrmTransferKernels* kernels = _trmTransferKernelsGet();
+
+    struct TrmBufferCursor dst;
+    struct TrmBufferCursor src;
+    _trmBufferCursorInit(&dst, job->pDst, job->pDstHost, job->dstOffset);
+    _trmBufferCursorInit(&src, job->pSrc, job->pSrcHost, job->srcOffset);
+
+    job->result = 0;
+
+    uint64_t remainingSize = job->size;
+    while (remainingSize > 0)
+    {
+        uint64_t dstSize = 0;
+        uint64_t srcSize = UINT64_MAX;
+        uint8_t* dstAddress = _trmBufferCursorSpan(&dst, &dstSize);
+        uint8_t* srcAddress = (job->operation == TRM_TRANSFER_FILL) ? NULL : _trmBufferCursorSpan(&src, &srcSize);
+
+        uint64_t size = remainingSize;
+        if (size > dstSize)
+            size = dstSize;
+        if (size > srcSize)
+            size = srcSize;
+
+        switch (job->operation)
+        {
+        case TRM_TRANSFER_FILL:
+            kernels->pFill(dstAddress, job->value, size, job->nonTemporal);
+            break;
+        case TRM_TRANSFER_COMPARE:
+            job->result = kernels->pCompare(dstAddress, srcAddress, size);
+            if (job->result != 0)
+                return;
+            break;
+        default:
+            kernels->pCopy(dstAddress, srcAddress, size, job->nonTemporal);
+            break;
+        }
+
+        _trmBufferCursorAdvance(&dst, size);
+        if (job->operation != TRM_TRANSFER_FILL)
+            _trmBufferCursorAdvance(&src, size);
+        remainingSize -= size;
+    }
+}
+
+// must be called with _trmTransferLock held
+static struct TrmTransferJob* _trmTransferQueuePop(void);
+static struct TrmTransferJob* _trmTransferQueuePop(void)
+{
+    struct TrmTransferJob* job = _trmTransferQueueHead;
+
+    if (job == NULL)
+        return NULL;
+
+    _trmTransferQueueHead = job->next;
+    if (_trmTransferQueueHead == NULL)
+        _trmTransferQueueTail = NULL;
+    job->next = NULL;
+
+    return job;
+}
+
+// runs a queued part and marks it as done. Must be called with _trmTransferLock held, which is released while the part runs
+static void _trmTransferPartRun(struct TrmTransferJob* pJob);
+static void _trmTransferPartRun(struct TrmTransferJob* pJob)
+{
+    TRM_MUTEX_UNLOCK(&_trmTransferLock);
+    _trmTransferJobRun(pJob);
+    TRM_MUTEX_LOCK(&_trmTransferLock);
+
+    (*pJob->pPending)--;
+    if (*pJob->pPending == 0)
+        TRM_CONDITION_BROADCAST(&_trmTransferDone);
+}
+
+static void _trmTransferWorkerRun(void* pParam);
+static void _trmTransferWorkerRun(void* pParam)
+{
+    (void)pParam;
+
+    TRM_MUTEX_LOCK(&_trmTransferLock);
+    while (true)
+    {
+        struct TrmTransferJob* job = _trmTransferQueuePop();
+
+        if (job != NULL)
+            _trmTransferPartRun(job);
+        else
+            TRM_CONDITION_WAIT(&_trmTransferQueued, &_trmTransferLock);
+    }
+}
+
+// makes sure there are at least `workerCount` workers. Must be called with _trmTransferLock held
+static void _trmTransferWorkersAdd(uint32_t workerCount);
+static void _trmTransferWorkersAdd(uint32_t workerCount)
+{
+    while (_trmTransferWorkerCount < workerCount)
+    {
+        struct TrmThreadInfo info = {
+            .pProc = &_trmTransferWorkerRun,
+        };
+        TrmThread worker = trmThreadCreate(&info);
+
+        // without the worker, its parts are done by the threads that split the jobs, so nothing is lost
+        if ((worker != NULL) && (trmThreadErrorGet(worker) < 0))
+        {
+            free(worker);
+            worker = NULL;
+        }
+        if (worker == NULL)
+            return;
+
+        _trmTransferWorkers[_trmTransferWorkerCount++] = worker;
+    }
+}
+
+// splits the job in `threadCount` consecutive parts, runs them and waits for all of them to finish
+static int _trmTransferJobSplit(struct TrmTransferJob* pJob, uint32_t threadCount);
+static int _trmTransferJobSplit(struct TrmTransferJob* pJob, uint32_t threadCount)
+{
+    pJob->nonTemporal = pJob->size > TRM_TRANSFER_NON_TEMPORAL_THRESHOLD;
+
+    if (threadCount > TRM_MAX_ITEM_COUNT)
+        threadCount = TRM_MAX_ITEM_COUNT;
+    if ((threadCount > 1) && (pJob->size / threadCount < TRM_TRANSFER_MIN_THREAD_SIZE))
+        threadCount = (uint32_t)(pJob->size / TRM_TRANSFER_MIN_THREAD_SIZE);
+
+    if (threadCount <= 1)
+    {
+        _trmTransferJobRun(pJob);
+        return pJob->result;
+    }
+
+    struct TrmTransferJob jobs[TRM_MAX_ITEM_COUNT];
+
+    // parts are page sized, so that two threads never write to the same cache line
+    uint64_t partSize = TRM_ALIGN_UP(pJob->size / threadCount, TRM_PAGE_SIZE);
+    uint64_t start = 0;
+    uint32_t partCount = 0;
+    for (; (partCount < threadCount) && (start < pJob->size); partCount++)
+    {
+        jobs[partCount] = *pJob;
+        jobs[partCount].dstOffset += start;
+        jobs[partCount].srcOffset += start;
+        jobs[partCount].size = ((pJob->size - start) < partSize) ? (pJob->size - start) : partSize;
+        start += jobs[partCount].size;
+    }
+
+    // the calling thread takes the first part itself and queues the rest for the workers
+    uint32_t pending = partCount - 1;
+
+    TRM_MUTEX_LOCK(&_trmTransferLock);
+    _trmTransferWorkersAdd(partCount - 1);
+    for (uint32_t i = 1; i < partCount; i++)
+    {
+        jobs[i].pPending = &pending;
+        jobs[i].next = NULL;
+
+        if (_trmTransferQueueTail != NULL)
+            _trmTransferQueueTail->next = &jobs[i];
+        else
+            _trmTransferQueueHead = &jobs[i];
+        _trmTransferQueueTail = &jobs[i];
+    }
+    TRM_CONDITION_BROADCAST(&_trmTransferQueued);
+    TRM_MUTEX_UNLOCK(&_trmTransferLock);
+
+    _trmTransferJobRun(&jobs[0]);
+
+    // while waiting, the calling thread runs the parts no worker has taken yet, so the job finishes even when all the workers are busy
+    TRM_MUTEX_LOCK(&_trmTransferLock);
+    while (pending > 0)
+    {
+        struct TrmTransferJob* job = _trmTransferQueuePop();
+
+        if (job != NULL)
+            _trmTransferPartRun(job);
+        else
+            TRM_CONDITION_WAIT(&_trmTransferDone, &_trmTransferLock);
+    }
+    TRM_MUTEX_UNLOCK(&_trmTransferLock);
+
+    // the first part that differs decides the result of a comparison
+    for (uint32_t i = 0; i < partCount; i++)
+    {
+        if (jobs[i].result != 0)
+            return jobs[i].result;
+    }
+
+    return 0;
+}
+
+/* -------------------- *
+ *   CHANGE             *
+ * -------------------- */
+
+int trmBufferFill(struct TrmBufferTransferInfo* pInfo, uint32_t value, TrmBuffer hBuffer)
+{
+    struct TrmTransferJob job = {
+        .operation = TRM_TRANSFER_FILL,
+        .pDst = TRM_BUFFER,
+        .dstOffset = pInfo->dstOffset * 4, // transform from 4-byte words to bytes
+        .size = pInfo->size * 4,
+        .value = value,
+    };
+
+    int error = _trmBufferRangeCheck(job.pDst, job.dstOffset, job.size);
+    if (error != TRM_SUCCESS)
+        return error;
+
+    _trmTransferJobSplit(&job, pInfo->threadCount);
+
+    return TRM_SUCCESS;
+}
+
+int trmBufferCopy(struct TrmBufferTransferInfo* pInfo, TrmBuffer hSrcBuffer, TrmBuffer hDstBuffer)
+{
+    struct TrmTransferJob job = {
+        .operation = TRM_TRANSFER_COPY,
+        .pDst = (struct TrmBuffer_T*)hDstBuffer,
+        .dstOffset = pInfo->dstOffset * 4,
+        .pSrc = (struct TrmBuffer_T*)hSrcBuffer,
+        .srcOffset = pInfo->srcOffset * 4,
+        .size = pInfo->size * 4,
+    };
+
+    int error = _trmBufferRangeCheck(job.pDst, job.dstOffset, job.size);
+    if (error == TRM_SUCCESS)
+        error = _trmBufferRangeCheck(job.pSrc, job.srcOffset, job.size);
+    if (error != TRM_SUCCESS)
+        return error;
+
+    _trmTransferJobSplit(&job, pInfo->threadCount);
+
+    return TRM_SUCCESS;
+}
+
+int trmBufferCopyFromHost(struct TrmBufferTransferInfo* pInfo, const void* pSrc, TrmBuffer hDstBuffer)
+{
+    struct TrmTransferJob job = {
+        .operation = TRM_TRANSFER_COPY_FROM_HOST,
+        .pDst = (struct TrmBuffer_T*)hDstBuffer,
+        .dstOffset = pInfo->dstOffset * 4,
+        .pSrcHost = (uint8_t*)pSrc,
+        .size = pInfo->size * 4,
+    };
+
+    int error = _trmBufferRangeCheck(job.pDst, job.dstOffset, job.size);
+    if (error != TRM_SUCCESS)
+        return error;
+
+    _trmTransferJobSplit(&job, pInfo->threadCount);
+
+    return TRM_SUCCESS;
+}
+
+int trmBufferCopyToHost(struct TrmBufferTransferInfo* pInfo, TrmBuffer hSrcBuffer, void* pDst)
+{
+    struct TrmTransferJob job = {
+        .operation = TRM_TRANSFER_COPY_TO_HOST,
+        .pDstHost = (uint8_t*)pDst,
+        .pSrc = (struct TrmBuffer_T*)hSrcBuffer,
+        .srcOffset = pInfo->srcOffset * 4,
+        .size = pInfo->size * 4,
+    };
+
+    int error = _trmBufferRangeCheck(job.pSrc, job.srcOffset, job.size);
+    if (error != TRM_SUCCESS)
+        return error;
+
+    _trmTransferJobSplit(&job, pInfo->threadCount);
+
+    return TRM_SUCCESS;
+}
+
+int trmBufferCompare(struct TrmBufferTransferInfo* pInfo, TrmBuffer hBufferA, TrmBuffer hBufferB, int* pResult)
+{
+    struct TrmTransferJob job = {
+        .operation = TRM_TRANSFER_COMPARE,
+        .pDst = (struct TrmBuffer_T*)hBufferA,
+        .dstOffset = pInfo->dstOffset * 4,
+        .pSrc = (struct TrmBuffer_T*)hBufferB,
+        .srcOffset = pInfo->srcOffset * 4,
+        .size = pInfo->size * 4,
+    };
+
+    int error = _trmBufferRangeCheck(job.pDst, job.dstOffset, job.size);
+    if (error == TRM_SUCCESS)
+        error = _trmBufferRangeCheck(job.pSrc, job.srcOffset, job.size);
+    if (error != TRM_SUCCESS)
+        return error;
+
+    *pResult = _trmTransferJobSplit(&job, pInfo->threadCount);
+
+    return TRM_SUCCESS;
+}
@@ -23,12 +23,81 @@
 
 #define TRM_MEMORY_POOL TRM_HANDLE(MemoryPool)
 #define TRM_BUFFER      TRM_HANDLE(Buffer)
+#define TRM_SCHEDULER   TRM_HANDLE(Scheduler)
+
+#define TRM_ALIGN_UP(value, alignment)   (((value) + ((uint64_t)(alignment) - 1)) & ~((uint64_t)(alignment) - 1)) // `alignment` must be a power of two
+#define TRM_ALIGN_DOWN(value, alignment) ((value) & ~((uint64_t)(alignment) - 1)) // `alignment` must be a power of two
 
 #ifdef _WIN32
     #include <Windows.h>
 #else 
     #include <pthread.h>
     #include <signal.h>
+    #include <time.h>
+#endif
+
+/* ================================ *
+ *          SYNCHRONIZATION         *
+ * ================================ */
+
+// atomics work on 64-bit values and pointers only. Loads acquire, stores release and read-modify-writes and fences are full barriers.
+#ifdef _WIN32
+    typedef SRWLOCK TrmMutex;
+    #define TRM_MUTEX_INITIALIZER      SRWLOCK_INIT
+    #define TRM_MUTEX_INIT(pMutex)     InitializeSRWLock(pMutex)
+    #define TRM_MUTEX_DESTROY(pMutex)  // SRW locks don't need to be destroyed
+    #define TRM_MUTEX_LOCK(pMutex)     AcquireSRWLockExclusive(pMutex)
+    #define TRM_MUTEX_TRY_LOCK(pMutex) (TryAcquireSRWLockExclusive(pMutex) != 0)
+    #define TRM_MUTEX_UNLOCK(pMutex)   ReleaseSRWLockExclusive(pMutex)
+
+    typedef CONDITION_VARIABLE TrmCondition;
+    #define TRM_CONDITION_INITIALIZER                CONDITION_VARIABLE_INIT
+    #define TRM_CONDITION_INIT(pCondition)           InitializeConditionVariable(pCondition)
+    #define TRM_CONDITION_INIT_MONOTONIC(pCondition) InitializeConditionVariable(pCondition) // timed waits are relative on Windows, so changes of the wall clock don't affect them anyway
+    #define TRM_CONDITION_DESTROY(pCondition)        // condition variables don't need to be destroyed
+    #define TRM_CONDITION_WAIT(pCondition, pMutex)   SleepConditionVariableSRW(pCondition, pMutex, INFINITE, 0)
+    #define TRM_CONDITION_SIGNAL(pCondition)         WakeConditionVariable(pCondition)
+    #define TRM_CONDITION_BROADCAST(pCondition)      WakeAllConditionVariable(pCondition)
+
+    #define TRM_THREAD_LOCAL __declspec(thread)
+
+    #define TRM_ATOMIC_LOAD64(pValue)                    ((uint64_t)ReadAcquire64((LONG64 const volatile*)(pValue)))
+    #define TRM_ATOMIC_STORE64(pValue, value)            WriteRelease64((LONG64 volatile*)(pValue), (LONG64)(value))
+    #define TRM_ATOMIC_ADD64(pValue, amount)             ((uint64_t)InterlockedExchangeAdd64((LONG64 volatile*)(pValue), (LONG64)(amount))) // returns the previous value
+    #define TRM_ATOMIC_CAS64(pValue, expected, desired)  (InterlockedCompareExchange64((LONG64 volatile*)(pValue), (LONG64)(desired), (LONG64)(expected)) == (LONG64)(expected))
+    #define TRM_ATOMIC_LOAD_PTR(pValue)                  ReadPointerAcquire((PVOID volatile*)(pValue))
+    #define TRM_ATOMIC_STORE_PTR(pValue, value)          WritePointerRelease((PVOID volatile*)(pValue), (PVOID)(value))
+    #define TRM_ATOMIC_CAS_PTR(pValue, expected, desired) (InterlockedCompareExchangePointer((PVOID volatile*)(pValue), (PVOID)(desired), (PVOID)(expected)) == (PVOID)(expected))
+    #define TRM_ATOMIC_FENCE()                           MemoryBarrier()
+#else
+    typedef pthread_mutex_t TrmMutex;
+    #define TRM_MUTEX_INITIALIZER      PTHREAD_MUTEX_INITIALIZER
+    #define TRM_MUTEX_INIT(pMutex)     pthread_mutex_init(pMutex, NULL)
+    #define TRM_MUTEX_DESTROY(pMutex)  pthread_mutex_destroy(pMutex)
+    #define TRM_MUTEX_LOCK(pMutex)     pthread_mutex_lock(pMutex)
+    #define TRM_MUTEX_TRY_LOCK(pMutex) (pthread_mutex_trylock(pMutex) == 0)
+    #define TRM_MUTEX_UNLOCK(pMutex)   pthread_mutex_unlock(pMutex)
+
+    typedef pthread_cond_t TrmCondition;
+    #define TRM_CONDITION_INITIALIZER                PTHREAD_COND_INITIALIZER
+    #define TRM_CONDITION_INIT(pCondition)           pthread_cond_init(pCondition, NULL)
+    #define TRM_CONDITION_INIT_MONOTONIC(pCondition) do { pthread_condattr_t attributes; pthread_condattr_init(&attributes); pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC); \
+                                                          pthread_cond_init(pCondition, &attributes); pthread_condattr_destroy(&attributes); } while (0) // timed waits on it take CLOCK_MONOTONIC deadlines
+    #define TRM_CONDITION_DESTROY(pCondition)        pthread_cond_destroy(pCondition)
+    #define TRM_CONDITION_WAIT(pCondition, pMutex)   pthread_cond_wait(pCondition, pMutex)
+    #define TRM_CONDITION_SIGNAL(pCondition)         pthread_cond_signal(pCondition)
+    #define TRM_CONDITION_BROADCAST(pCondition)      pthread_cond_broadcast(pCondition)
+
+    #define TRM_THREAD_LOCAL _Thread_local
+
+    #define TRM_ATOMIC_LOAD64(pValue)                    __atomic_load_n((uint64_t*)(pValue), __ATOMIC_ACQUIRE)
+    #define TRM_ATOMIC_STORE64(pValue, value)            __atomic_store_n((uint64_t*)(pValue), (uint64_t)(value), __ATOMIC_RELEASE)
+    #define TRM_ATOMIC_ADD64(pValue, amount)             __atomic_fetch_add((uint64_t*)(pValue), (uint64_t)(amount), __ATOMIC_SEQ_CST) // returns the previous value
+    #define TRM_ATOMIC_CAS64(pValue, expected, desired)  __sync_bool_compare_and_swap((uint64_t*)(pValue), (uint64_t)(expected), (uint64_t)(desired))
+    #define TRM_ATOMIC_LOAD_PTR(pValue)                  __atomic_load_n((void**)(pValue), __ATOMIC_ACQUIRE)
+    #define TRM_ATOMIC_STORE_PTR(pValue, value)          __atomic_store_n((void**)(pValue), (void*)(value), __ATOMIC_RELEASE)
+    #define TRM_ATOMIC_CAS_PTR(pValue, expected, desired) __sync_bool_compare_and_swap((void**)(pValue), (void*)(expected), (void*)(desired))
+    #define TRM_ATOMIC_FENCE()                           __atomic_thread_fence(__ATOMIC_SEQ_CST)
 #endif
 
 /* ================================ *
@@ -41,8 +110,8 @@ struct TrmMemoryBlock_T
     uint64_t used; // in BYTES, not in 4-byte words like in dflMemoryBlockInit
     void* startingAddress;
 
-    uint64_t slots[TRM_MAX_ITEM_COUNT * 2]; // for 2n and (2n + 1), where n natural number, slots[2n] is the first available slot and slots[2n + 1] is the last available slot in a contiguous free part of the memory block.
-    // this does mean that if there are more than 64 free non-contiguous parts, then the memory block will not be able to use some of them (forever), but I *think* it's unlikely that 
+    uint64_t slots[TRM_MAX_ITEM_COUNT * 2]; // for 2n and (2n + 1), where n natural number, slots[2n] is the first available byte and slots[2n + 1] is the end of a contiguous free part of the memory block. If slots[2n] >= slots[2n + 1], the slot is unused.
+    // this does mean that if there are more than 64 free non-contiguous parts, then the memory block will not be able to use the smallest of them until it is completely empty again, but I *think* it's unlikely that
     // a user will free 64 non-contiguous parts of memory one after the other without allocating anything in between.
 
     VkDeviceMemory hMemoryHandle;
@@ -51,39 +120,62 @@ struct TrmMemoryBlock_T
     VkDevice       hDevice; // the device associated with the block (if a device is used)
     void* miniBuff; // if memory is unmappable, then this will be a small (4 bytes) buffer that will be used to copy data to the vulkan buffer.
 
-    struct DflMemoryBlock_T* next; // the next memory block
+    TrmMutex lock; // guards `used` and `slots` in concurrent pools
+
+    struct TrmMemoryBlock_T* next; // the next memory block
 };
 
 struct TrmMemoryPool_T
 {
-    uint64_t size; // in BYTES, not in 4-byte words like in dflMemoryPoolInit
-    uint64_t used; // in BYTES, not in 4-byte words like in dflMemoryPoolInit
+    uint64_t size; // in BYTES, not in 4-byte words like in dflMemoryPoolInit. Atomic in concurrent pools
+    uint64_t used; // in BYTES, not in 4-byte words like in dflMemoryPoolInit. Atomic in concurrent pools
 
-    struct DflMemoryBlock_T* firstBlock; // the first memory block
+    uint32_t flags; // TRM_MEMORY_POOL_*_BIT flags
 
-    int error;
+    struct TrmMemoryBlock_T* firstBlock; // the first memory block
+    uint64_t                 blockCount; // atomic in concurrent pools, so threads can spread over the blocks without walking the list first
+    TrmMutex                 expandLock; // only one thread at a time can append blocks to a concurrent pool, or use the command pools of its buffers, which Vulkan doesn't synchronize
+
+    int error; // concurrent pools don't use this, as threads would overwrite each other's errors. Errors are kept per thread instead
+    uint64_t id; // tags the errors of the pool that are kept in thread contexts. Never 0
+
+    // debug pools only
+    TrmMutex            debugLock; // guards the lists below
+    struct TrmBuffer_T* liveBuffers; // the buffers that haven't been freed yet
+    struct TrmBuffer_T* quarantine[TRM_MAX_ITEM_COUNT]; // freed buffers, whose memory isn't given back to the blocks until they are pushed out by newer ones
+    uint32_t            quarantineNext; // where the next freed buffer goes in `quarantine`
+    struct TrmBuffer_T* freedHead; // the handles of buffers pushed out of the quarantine. They are kept, still marked as freed, so freeing them again
+    struct TrmBuffer_T* freedTail; // is reported instead of reading freed memory. New buffers reuse the oldest ones, once there are enough of them
+    uint32_t            freedCount;
 };
 
 struct TrmBufferChunk_T // chunks concern individual memory blocks and are part of a buffer
 {
     struct TrmMemoryBlock_T* associatedBlock; // the memory block that this chunk is part of
-    uint64_t size; // the size of the chunk
-    uint64_t offset; // the offset of the chunk in the memory block
+    uint64_t size; // the size of the chunk, in BYTES
+    uint64_t offset; // the offset of the chunk in the memory block, in BYTES
+    uint64_t reserved; // how many bytes the chunk took from the block, starting at `offset`. Bigger than `size` when the chunk is padded to a whole cache line or has a redzone after it
+    uint64_t padding; // how many bytes before `offset` also belong to the chunk (the redzone in front of it, in debug pools)
 
     VkCommandBuffer transferOp; // the tranfer operation used for unmapped buffers responsible for copying the data from the starting address to the vulkan buffer. 
+    VkCommandPool   hCommandPool; // the pool `transferOp` was allocated from, so it can be given back when the buffer is freed
     VkEvent         hostCanGetNextPart; // since the small host buffer for unmapped buffer is just 4 bytes, we need to signal to the host each time 4 bytes are transferred to the vulkan buffer so the host can copy the next 4 bytes to the small host buffer.
     VkFence         isTransferDone; // the fence will be signaled when the transfer operation is done.
 };
 
 struct TrmBuffer_T
 {
-    uint64_t size;
+    uint64_t size; // in BYTES
 
     // A buffer can create DFL_MAX_ITEM_COUNT chunks in total. A chunk is associated with a "slot" of available memory in blocks of the memory pool.
     // If the number of slots the buffer needs is more than DFL_MAX_ITEM_COUNT, then the buffer will only have DFL_MAX_ITEM_COUNT chunks and will be smaller than the requested size.
     // In such a case, the memory pool will report an error, although the buffer creation will, technically, be successful.
     struct TrmBufferChunk_T chunks[TRM_MAX_ITEM_COUNT];
 
+    struct TrmBuffer_T* previous; // links of the live buffers of a debug pool
+    struct TrmBuffer_T* next;
+    bool                isFreed; // the buffer is in the quarantine or in the freed handles of its debug pool
+
     // DflBuffers won't have an error field, the memory pool will have buffer related errors reported in its error field instead.
 };
 
@@ -105,4 +197,137 @@ struct TrmThread_T
    int error;
 };
 
+/* ================================ *
+ *             TIMERS               *
+ * ================================ */
+
+#define TRM_WHEEL_LEVEL_COUNT 4 // with 64 slots per level, the wheel covers 2^24 ticks. Timers further away are cascaded until they fit
+#define TRM_WHEEL_SLOT_BITS   6
+#define TRM_WHEEL_SLOT_COUNT  (1 << TRM_WHEEL_SLOT_BITS)
+
+#define TRM_TIMER_PAGE_SIZE  256 // timers are kept in pages of their scheduler that never move or get freed, so a handle can be checked before it's used
+#define TRM_TIMER_INDEX_BITS 24 // a handle is the index of its timer (plus 1, so it's never NULL) and, above it, the generation of the timer
+
+struct TrmTimer_T
+{
+    struct TrmTimerInfo info;
+
+    uint64_t deadline; // in ticks, when the timer should fire. Periodic timers add their period to this, so they don't drift
+    uint64_t expiry; // in ticks, when the timer will fire: the deadline rounded up to the coalescing window. The wheel places the timer by this
+    uint64_t period; // in ticks, 0 for timers that fire once
+
+    int level; // where the timer is in the wheel. -1 if it isn't in it
+    int slot;
+
+    // links of the slot of the wheel (or the dispatch queue, or the free timers) the timer is in
+    struct TrmTimer_T* previous;
+    struct TrmTimer_T* next;
+
+    uint32_t  index; // where the timer is in the pages of its scheduler
+    uintptr_t generation; // changes every time the timer is released, so the handles of its previous uses don't match it anymore
+
+    bool isUsed; // false while the timer is in the free timers
+    bool isQueued; // waiting for a worker thread
+    bool isRunning; // its callback is running
+    bool isCancelled; // the user has released it
+};
+
+struct TrmScheduler_T
+{
+    struct TrmSchedulerInfo info;
+
+    TrmMutex     lock; // guards everything below
+    TrmCondition timerCondition; // wakes the timer thread up when a timer is added before its next wake up, or when the scheduler is destroyed
+    TrmCondition workCondition; // wakes the worker threads up when there are timers in the dispatch queue
+
+    TrmThread hTimerThread;
+    TrmThread hWorkers[TRM_MAX_ITEM_COUNT];
+
+    uint64_t startTime; // in milliseconds, the time the ticks are counted from
+    uint64_t windowTicks; // the coalescing window, in ticks
+    uint64_t currentTick;
+    uint64_t nextWakeTick; // when the timer thread will wake up next. UINT64_MAX if it sleeps until it's woken up
+
+    struct TrmTimer_T* wheel[TRM_WHEEL_LEVEL_COUNT][TRM_WHEEL_SLOT_COUNT];
+    uint64_t           occupied[TRM_WHEEL_LEVEL_COUNT]; // a bit per slot, set if the slot has timers
+    uint64_t           timerCount; // how many timers are in the wheel
+
+    struct TrmTimer_T* queueHead; // the dispatch queue, for timers that have expired
+    struct TrmTimer_T* queueTail;
+
+    struct TrmTimer_T** timerPages; // every page holds TRM_TIMER_PAGE_SIZE timers
+    uint32_t            timerPageCount;
+    struct TrmTimer_T*  freeTimers; // released timers, reused by new ones
+
+    bool isStopping;
+
+    int error;
+};
+
+/* ================================ *
+ *             EPOCHS               *
+ * ================================ */
+
+#define TRM_EPOCH_BATCH_SIZE 64 // how many objects a thread retires before it tries to free them
+
+struct TrmEpochRetired_T
+{
+    void*             pObject;
+    TrmReclaimProcess pProc;
+    void*             pParam;
+
+    uint64_t epoch; // the global epoch when the object was retired. It can be freed once the global epoch is 2 epochs later
+
+    struct TrmEpochRetired_T* next;
+};
+
+struct TrmEpochRecord_T // part of every thread's context
+{
+    uint64_t announced; // (epoch << 1) | 1 while the thread is in a critical section, 0 otherwise. Written only by its thread
+    uint32_t nesting;
+
+    // the limbo list. Objects are retired in order, so the oldest ones are always at its head
+    struct TrmEpochRetired_T* limboHead;
+    struct TrmEpochRetired_T* limboTail;
+    uint64_t                  limboCount;
+
+    struct TrmEpochRecord_T* previous;
+    struct TrmEpochRecord_T* next;
+
+    bool isRegistered; // the record is in the list of records
+};
+
+void _trmEpochThreadRegister(void); // called by threads created by trmThreadCreate before they start
+
+/* ================================ *
+ *         THREAD CONTEXTS          *
+ * ================================ */
+
+struct TrmMemoryPoolError_T
+{
+    uint64_t poolId; // the pool the error belongs to. 0 if there's no error
+    int      error;
+};
+
+#define TRM_THREAD_LOCAL_DESTRUCTOR_ITERATIONS 4 // how many times the destructors of a finishing thread are run over, for thread locals that destructors get again. Like PTHREAD_DESTRUCTOR_ITERATIONS
+
+struct TrmThreadContext_T
+{
+    // Termite's own per-thread state
+    struct TrmMemoryPoolError_T memoryErrors[TRM_MAX_ITEM_COUNT]; // the errors of concurrent pools, at their pool's id modulo TRM_MAX_ITEM_COUNT. If two pools share a place,
+    // the pool that failed last overwrites the other's error, but a pool never gets an error of another pool
+    uint64_t                blockHint; // which block the thread tries first in concurrent pools. 0 means that it hasn't been picked yet
+    struct TrmEpochRecord_T epochRecord;
+    struct TrmScheduler_T*  runningScheduler; // the scheduler whose callback the thread is running, if it is running one
+
+    void* locals[TRM_MAX_ITEM_COUNT]; // the thread's copies of the registered thread locals, allocated the first time the thread gets them
+};
+
+extern TRM_THREAD_LOCAL struct TrmThreadContext_T* _trmThreadContext;
+
+struct TrmThreadContext_T* _trmThreadContextCreate(void); // sets up the context of the calling thread
+void _trmThreadContextDestroy(void); // runs the destructors of the thread locals of the calling thread and releases its context
+
+#define TRM_THREAD_CONTEXT (_trmThreadContext != NULL ? _trmThreadContext : _trmThreadContextCreate()) // the context of the calling thread. A single load once it's set up
+
 #endif
\ No newline at end of file
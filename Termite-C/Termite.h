@@ -49,9 +49,16 @@ extern "C" {
 #define TRM_GENERIC_NO_SUCH_FILE_ERROR -0x1002
 #define TRM_GENERIC_OUT_OF_BOUNDS_ERROR -0x1003 // attempted to create more items than the maximum allowed
 #define TRM_GENERIC_ALREADY_INITIALIZED_ERROR -0x1004 // the item is already initialized
+#define TRM_GENERIC_INVALID_ARGUMENT_ERROR -0x1005 // an argument has a value the function can't work with
 
 #define TRM_MEMORY_UNAVAILABLE_BLOCKS_ERROR -0x2001 // no more memory blocks available
 #define TRM_MEMORY_OOM_ERROR -0x2002 // no more memory available from pool
+#define TRM_MEMORY_INVALID_ALIGNMENT_ERROR -0x2003 // requested alignment is not a power of two or is bigger than TRM_PAGE_SIZE
+#define TRM_MEMORY_OUT_OF_BOUNDS_ERROR -0x2004 // attempted to access memory past the end of a buffer
+#define TRM_MEMORY_UNMAPPED_ERROR -0x2005 // the buffer lives in device memory that isn't mapped to the host
+#define TRM_MEMORY_CORRUPTION_ERROR -0x2006 // something wrote past the bounds of a buffer of a debug pool
+#define TRM_MEMORY_USE_AFTER_FREE_ERROR -0x2007 // something wrote to a freed buffer of a debug pool
+#define TRM_MEMORY_DOUBLE_FREE_ERROR -0x2008 // a buffer of a debug pool was freed twice
 
 #define TRM_VULKAN_DEVICE_NO_MEMORY_ERROR -0x3001 // vulkan device has no memory available for allocation
 #define TRM_VULKAN_DEVICE_UNMAPPABLE_MEMORY_ERROR -0x3001 // vulkan device couldn't map memory to host.
@@ -59,11 +66,14 @@ extern "C" {
 #define TRM_VULKAN_DEVICE_COMMAND_CREATION_ERROR -0x3001 // vulkan device couldn't create command buffer
 
 #define TRM_THREAD_COULDNT_CREATE_ERROR -0x4001 // couldn't create thread
+#define TRM_THREAD_DEADLOCK_ERROR -0x4002 // the call would wait for the calling thread itself to finish
 
 
 // other definitions
 #define TRM_MAX_CHAR_COUNT 256 // the maximum number of characters that can be used in a string
 #define TRM_MAX_ITEM_COUNT 64 // the maximum number of items that can be used in an array (it's a safe amount for objects that are likely to not be numerous in an application)
+#define TRM_CACHE_LINE_SIZE 64 // the size of a cache line, in bytes
+#define TRM_PAGE_SIZE 4096 // the size of a memory page, in bytes. It's also the biggest alignment a buffer can ask for
 
 /* -------------------- *
  *       HANDLES        *
@@ -92,9 +102,14 @@ struct TrmVkDeviceMemInfo
 };
 #endif
 
+#define TRM_MEMORY_POOL_CONCURRENT_BIT 0x1 // the pool can be used by many threads at once. Each block has its own lock and errors are reported per thread
+#define TRM_MEMORY_POOL_DEBUG_BIT 0x2 // every chunk is surrounded by redzones and freed buffers are poisoned and quarantined for a while, so overruns, uses after free and double frees can be caught. The handles of freed buffers are reused, oldest first, and a double free is only missed once its handle has been reused
+#define TRM_MEMORY_POOL_DEBUG_BOUNDED_BIT 0x4 // with TRM_MEMORY_POOL_DEBUG_BIT, only the first and last 256 bytes of every chunk of a freed buffer are poisoned, so freeing big buffers stays cheap. Writes to the rest are only caught with ASan
+
 struct TrmMemoryPoolInfo
 {
     uint64_t size; // size of pool, in 4-byte words
+    uint32_t flags; // TRM_MEMORY_POOL_*_BIT flags. Only read by trmMemoryPoolCreate
 
 #ifndef TRM_NO_VULKAN
     VkDevice device; // set to point to a Vulkan device if the memory pool should be allocated from the device
@@ -119,9 +134,13 @@ struct TrmQueueInfo
 };
 
 
+#define TRM_BUFFER_SEPARATE_CACHE_LINE_BIT 0x1 // the buffer won't share any cache line with other buffers (useful for data that is written by different threads)
+
 struct TrmBufferInfo
 {
     uint64_t size; // size of buffer, in 4-byte words
+    uint32_t alignment; // alignment of the addresses of the buffer's chunks, in BYTES (of their offsets, for unmapped device memory). Must be a power of two no bigger than TRM_PAGE_SIZE. 0 means the default (4-byte) alignment
+    uint32_t flags; // TRM_BUFFER_*_BIT flags
 
 #ifndef TRM_NO_VULKAN
     VkDevice             device;
@@ -130,12 +149,23 @@ struct TrmBufferInfo
 #endif
 };
 
+struct TrmBufferTransferInfo
+{
+    uint64_t dstOffset; // where the operation starts in the destination (or first) buffer, in 4-byte words
+    uint64_t srcOffset; // where the operation starts in the source (or second) buffer, in 4-byte words. Ignored for host memory and fills
+    uint64_t size; // how much memory the operation concerns, in 4-byte words
+
+    uint32_t threadCount; // how many threads the work is split into. 0 and 1 mean that the calling thread does all the work. The other threads are workers that are created the first time they are needed and kept until the process ends
+};
+
 /* -------------------- *
  *   INITIALIZE         *
  * -------------------- */
 
 /*
 * @brief Initialize a memory pool.
+*
+* @return The memory pool, or NULL if it or its first block couldn't be created.
 */
 TrmMemoryPool trmMemoryPoolCreate(struct TrmMemoryPoolInfo* pInfo);
 
@@ -151,7 +181,8 @@ void trmMemoryPoolExpand(struct TrmMemoryPoolInfo* pInfo, TrmMemoryPool hMemoryP
 /*
 * @brief Allocate memory from a pool for a buffer.
 *
-* @param size: The size of the buffer, in 4-byte words
+* @param size: The size of the buffer, in 4-byte words. Must not be 0, or TRM_GENERIC_INVALID_ARGUMENT_ERROR is reported
+* @param alignment: The alignment of the address of every chunk of the buffer, in bytes. Any padding needed to align a chunk is kept in the block as free memory.
 */
 TrmBuffer trmAllocate(struct TrmBufferInfo* pBufferInfo, TrmMemoryPool hMemoryPool);
 
@@ -163,11 +194,46 @@ TrmBuffer trmAllocate(struct TrmBufferInfo* pBufferInfo, TrmMemoryPool hMemoryPo
 void trmReallocate(struct TrmBufferInfo* pBufferInfo, TrmBuffer hBuffer, TrmMemoryPool hMemoryPool);
 
 /*
-* @brief Free the memory of a buffer.
+* @brief Free the memory of a buffer. The memory is given back to the blocks it was taken from.
 *
 */
 void trmFree(TrmBuffer hBuffer, TrmMemoryPool hMemoryPool);
 
+/*
+* @brief Fill part of a buffer with a 4-byte value.
+*
+* @return TRM_SUCCESS, or an error code if the range is out of the buffer's bounds or the buffer isn't mapped to the host.
+*/
+int trmBufferFill(struct TrmBufferTransferInfo* pInfo, uint32_t value, TrmBuffer hBuffer);
+
+/*
+* @brief Copy part of a buffer to another buffer. The buffers shouldn't overlap.
+*
+* @return TRM_SUCCESS, or an error code if a range is out of its buffer's bounds or a buffer isn't mapped to the host.
+*/
+int trmBufferCopy(struct TrmBufferTransferInfo* pInfo, TrmBuffer hSrcBuffer, TrmBuffer hDstBuffer);
+
+/*
+* @brief Copy host memory into a buffer.
+*
+* @param pSrc: The host memory to copy from. `pInfo->srcOffset` is ignored.
+*/
+int trmBufferCopyFromHost(struct TrmBufferTransferInfo* pInfo, const void* pSrc, TrmBuffer hDstBuffer);
+
+/*
+* @brief Copy part of a buffer into host memory.
+*
+* @param pDst: The host memory to copy to. `pInfo->dstOffset` is ignored and `pInfo->srcOffset` is the offset in the buffer.
+*/
+int trmBufferCopyToHost(struct TrmBufferTransferInfo* pInfo, TrmBuffer hSrcBuffer, void* pDst);
+
+/*
+* @brief Compare part of two buffers, byte by byte. `pInfo->dstOffset` is the offset in `hBufferA` and `pInfo->srcOffset` the offset in `hBufferB`.
+*
+* @param pResult: Set to 0 if the ranges are equal, otherwise to a negative or positive value, like memcmp does.
+*/
+int trmBufferCompare(struct TrmBufferTransferInfo* pInfo, TrmBuffer hBufferA, TrmBuffer hBufferB, int* pResult);
+
 /* -------------------- *
  *   GET & SET          *
  * -------------------- */
@@ -182,8 +248,18 @@ extern inline int trmMemoryPoolSizeGet(TrmMemoryPool hMemoryPool);
 */
 extern inline int trmMemoryPoolBlockCountGet(TrmMemoryPool hMemoryPool);
 
+/*
+* @brief Get the last error of a memory pool. For concurrent pools, this is the last error the calling thread caused in that pool.
+*/
 extern inline int trmMemoryPoolErrorGet(TrmMemoryPool hMemoryPool);
 
+/*
+* @brief Check the redzones of all the buffers of a debug pool, as well as the poisoned memory of its quarantined buffers. Does nothing for other pools.
+*
+* @return TRM_SUCCESS, TRM_MEMORY_CORRUPTION_ERROR or TRM_MEMORY_USE_AFTER_FREE_ERROR. The error is also reported by the pool.
+*/
+int trmMemoryPoolValidate(TrmMemoryPool hMemoryPool);
+
 /* -------------------- *
  *   DESTROY            *
  * -------------------- */
@@ -217,7 +293,17 @@ struct TrmThreadInfo
     TrmThreadProcess pProc; // function to execute in the thread
 };
 
+struct TrmThreadLocalInfo
+{
+    uint32_t         size; // size of the data of the thread local in bytes. Every thread gets its own copy, zeroed
+    TrmThreadProcess pDestructor; // called with the thread's copy of the data when the thread finishes, before the data is freed. Can be NULL.
+    // It may get thread locals again, whose destructors then run too, up to a few times over
+};
+
 TRM_MAKE_HANDLE(TrmThread);
+TRM_MAKE_HANDLE(TrmThreadContext); // the per-thread state of a thread. Every thread has one, including threads that weren't created by Termite
+
+#define TRM_THREAD_LOCAL_GET(type, slot) ((type*)trmThreadLocalGet(trmThreadContextGet(), (slot))) // a shorthand for getting the calling thread's copy of a thread local as `type*`
 
 /* -------------------- *
  *   INITIALIZE         *
@@ -229,6 +315,13 @@ TRM_MAKE_HANDLE(TrmThread);
 */
 TrmThread trmThreadCreate(struct TrmThreadInfo* pInfo);
 
+/*
+* @brief Register a thread local. Meant to be called once per thread local, at startup.
+*
+* @return The slot of the thread local, or TRM_GENERIC_OUT_OF_BOUNDS_ERROR if TRM_MAX_ITEM_COUNT thread locals are registered already.
+*/
+int trmThreadLocalRegister(struct TrmThreadLocalInfo* pInfo);
+
 /* -------------------- *
  *   CHANGE             *
  * -------------------- */
@@ -252,6 +345,151 @@ extern inline bool trmThreadIsRunning(TrmThread hThread);
 */
 extern inline int trmThreadErrorGet(TrmThread hThread);
 
+/*
+* @brief Get the context of the calling thread. It's set up the first time it's needed and released when the thread finishes.
+* It must not be passed to other threads.
+*/
+TrmThreadContext trmThreadContextGet(void);
+
+/*
+* @brief Get a thread's copy of the data of a thread local. The data is allocated the first time it's needed.
+*
+* @return A pointer to the data, or NULL if the slot isn't registered or the data couldn't be allocated.
+*/
+void* trmThreadLocalGet(TrmThreadContext hThreadContext, int slot);
+
+/* ================================ *
+ *             TIMERS               *
+ * ================================ */
+
+/* -------------------- *
+ *      TYPES           *
+ * -------------------- */
+
+struct TrmSchedulerInfo
+{
+    uint32_t workerCount; // how many threads run the callbacks of expired timers. 0 means that the timer thread runs them itself
+    uint32_t stackSize; // size of the stack of the scheduler's threads in bytes
+
+    uint32_t resolution; // the length of a tick of the timer wheel, in milliseconds. 0 means 1 millisecond
+    uint32_t coalescingWindow; // in milliseconds. Timers are delayed up to this much so that timers close to each other fire together. 0 means no coalescing
+};
+
+struct TrmTimerInfo
+{
+    uint64_t delay; // how long until the timer fires (the first time, for periodic timers), in milliseconds
+    uint64_t period; // how long between two firings of a periodic timer, in milliseconds. Ignored by trmScheduleAfter
+
+    void*            pParam; // parameter to pass to the callback
+    TrmThreadProcess pProc; // the callback of the timer
+};
+
+TRM_MAKE_HANDLE(TrmScheduler);
+TRM_MAKE_HANDLE(TrmTimer);
+
+/* -------------------- *
+ *   INITIALIZE         *
+ * -------------------- */
+
+/*
+* @brief Create a scheduler, with its timer thread and its worker threads.
+*/
+TrmScheduler trmSchedulerCreate(struct TrmSchedulerInfo* pInfo);
+
+/* -------------------- *
+ *   CHANGE             *
+ * -------------------- */
+
+/*
+* @brief Run a callback once, after `pInfo->delay` milliseconds.
+*
+* @return The timer, or NULL if it couldn't be created. The scheduler releases it after its callback has run, so trmTimerCancel is only needed to cancel it before that.
+*/
+TrmTimer trmScheduleAfter(struct TrmTimerInfo* pInfo, TrmScheduler hScheduler);
+
+/*
+* @brief Run a callback after `pInfo->delay` milliseconds and then every `pInfo->period` milliseconds, until the timer is cancelled.
+*
+* @return The timer, which must be released with trmTimerCancel, or NULL if it couldn't be created.
+*/
+TrmTimer trmScheduleEvery(struct TrmTimerInfo* pInfo, TrmScheduler hScheduler);
+
+/*
+* @brief Cancel a timer and release it. A callback that is already running is not interrupted. Does nothing if the timer was released already,
+* like a timer of trmScheduleAfter that has fired.
+*/
+void trmTimerCancel(TrmTimer hTimer, TrmScheduler hScheduler);
+
+/* -------------------- *
+ *   GET & SET          *
+ * -------------------- */
+
+extern inline int trmSchedulerErrorGet(TrmScheduler hScheduler);
+
+/* -------------------- *
+ *   DESTROY            *
+ * -------------------- */
+
+/*
+* @brief Destroy a scheduler. Waits for running callbacks to finish and releases all the timers of the scheduler, so their handles can't be used afterwards.
+* It can't be called from a callback of the scheduler, as it would wait for that callback forever. Then it does nothing and the scheduler reports TRM_THREAD_DEADLOCK_ERROR.
+*/
+void trmSchedulerDestroy(TrmScheduler hScheduler);
+
+/* ================================ *
+ *             EPOCHS               *
+ * ================================ */
+
+/*
+* Epochs let lock-free structures free memory that other threads may still be reading.
+* Readers wrap their accesses in trmEpochEnter/trmEpochExit. Writers retire what they have unlinked instead of freeing it,
+* and it's freed once every thread has left the critical sections that could have seen it.
+* Threads are registered the first time they use epochs (or when they start, if created with trmThreadCreate) and unregistered when they finish.
+*/
+
+/* -------------------- *
+ *      TYPES           *
+ * -------------------- */
+
+typedef void (*TrmReclaimProcess)(void* pObject, void* pParam); // a function that frees a retired object
+
+/* -------------------- *
+ *   CHANGE             *
+ * -------------------- */
+
+/*
+* @brief Enter a critical section. Critical sections can be nested.
+*/
+void trmEpochEnter(void);
+
+/*
+* @brief Leave a critical section.
+*/
+void trmEpochExit(void);
+
+/*
+* @brief Free an object once no thread can be reading it anymore.
+*
+* @param pProc: The function that frees the object. It's called as pProc(pObject, pParam), possibly from another thread.
+*/
+void trmEpochRetire(void* pObject, TrmReclaimProcess pProc, void* pParam);
+
+/*
+* @brief Free a buffer with trmFree once no thread can be reading it anymore.
+*/
+void trmEpochRetireBuffer(TrmBuffer hBuffer, TrmMemoryPool hMemoryPool);
+
+/*
+* @brief Free as much of what the calling thread has retired as possible, without waiting for a full batch. Must be called outside of a critical section.
+*/
+void trmEpochFlush(void);
+
+/*
+* @brief Unregister the calling thread before it finishes. What it has retired and can't be freed yet is freed later by other threads.
+* Every thread is unregistered when it finishes anyway, so this is only needed by threads that stop using epochs early.
+*/
+void trmEpochThreadUnregister(void);
+
 #ifdef __cplusplus
 }
 #endif